@@ -25,6 +25,7 @@ MediaStream::MediaStream()
       m_device(""),
       m_backend(""),
       m_resolution(""),
+      m_quality("float"),
       m_videoModel(nullptr)
 {
 
@@ -170,6 +171,21 @@ void MediaStream::setResolution(QString resolution)
     }
 }
 
+QString MediaStream::getQuality()
+{
+    return m_quality;
+}
+
+// Interpolation passed to the backends: nearest, q8, q16 or float
+void MediaStream::setQuality(QString quality)
+{
+    if (quality == "nearest" || quality == "q8" || quality == "q16" || quality == "float") {
+        m_quality = quality;
+        qDebug() << "[MediaStream] Quality set: " << m_quality;
+        Q_EMIT qualityChanged();
+    }
+}
+
 void MediaStream::pause()
 {
     if (m_isInitialized == true && m_playing == true) {
@@ -182,32 +198,32 @@ void MediaStream::play()
     if (m_isInitialized == true) {
         m_playing = true;
 
-        char buffer[20];
-        QString resolution = m_resolution;
-        const char *r = resolution.toStdString().c_str();
-        strncpy(buffer, r, sizeof(buffer));
-        buffer[sizeof(buffer) - 1] = '\0';
-
-        char *w = strtok(buffer, "x");
-        char *h = strtok(NULL, "x");
+        // "WxH" or "WxH@fps" as listed by VideoDevice::deviceResolution()
+        QString size = m_resolution.section('@', 0, 0);
+        QString rate = m_resolution.section('@', 1, 1);
+        QString w = size.section('x', 0, 0);
+        QString h = size.section('x', 1, 1);
+        QStringList args = QStringList() << m_device << w << h << QString::number(m_angle) << "--quality=" + m_quality;
+        if (!rate.isEmpty())
+            args << "--fps=" + rate;
 
         if (m_backend == "G2D")
         {
             qDebug() << "   Launching G2D demo...";
-            qDebug() << QString(DEMOPATH) + "/" + DEMOG2D << QStringList() << m_device << w << h << QString::number(m_angle);
-            m_process->start(QString(DEMOPATH) + "/" + DEMOG2D, QStringList() << m_device << w << h << QString::number(m_angle));
+            qDebug() << QString(DEMOPATH) + "/" + DEMOG2D << args;
+            m_process->start(QString(DEMOPATH) + "/" + DEMOG2D, args);
         }
         if (m_backend == "OpenCV")
         {
             qDebug() << "   Launching OpenCV demo...";
-            qDebug() << QString(DEMOPATH) + "/" + DEMOOPENCV << QStringList() << m_device << w << h << QString::number(m_angle);
-            m_process->start(QString(DEMOPATH) + "/" + DEMOOPENCV, QStringList() << m_device << w << h << QString::number(m_angle));
+            qDebug() << QString(DEMOPATH) + "/" + DEMOOPENCV << args;
+            m_process->start(QString(DEMOPATH) + "/" + DEMOOPENCV, args);
         }
         if (m_backend == "OpenGL")
         {
             qDebug() << "   Launching OpenGL demo...";
-            qDebug() << QString(DEMOPATH) + "/" + DEMOOPENGL << QStringList() << m_device << w << h << QString::number(m_angle);
-            m_process->start(QString(DEMOPATH) + "/" + DEMOOPENGL, QStringList() << m_device << w << h << QString::number(m_angle));
+            qDebug() << QString(DEMOPATH) + "/" + DEMOOPENGL << args;
+            m_process->start(QString(DEMOPATH) + "/" + DEMOOPENGL, args);
 
         }
     }
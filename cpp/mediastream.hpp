@@ -24,6 +24,7 @@ class MediaStream : public QQuickItem
     Q_PROPERTY(int angle READ getAngle WRITE setAngle NOTIFY angleChanged)
     Q_PROPERTY(QString backend READ getBackend WRITE setBackend NOTIFY backendChanged)
     Q_PROPERTY(QString resolution READ getResolution WRITE setResolution NOTIFY resolutionChanged)
+    Q_PROPERTY(QString quality READ getQuality WRITE setQuality NOTIFY qualityChanged)
     Q_PROPERTY(QString source READ getSource WRITE setSource NOTIFY sourceChanged)
     Q_PROPERTY(QStringList devices READ getDevices NOTIFY devicesChanged)
     Q_PROPERTY(QStringList resolutions READ getResolutions NOTIFY resolutionsChanged)
@@ -46,6 +47,9 @@ public Q_SLOTS:
     QString getResolution();
     void setResolution(QString res);
 
+    QString getQuality();
+    void setQuality(QString quality);
+
     QStringList getDevices();
     QStringList getResolutions();
 
@@ -61,6 +65,7 @@ Q_SIGNALS:
     void angleChanged();
     void backendChanged();
     void resolutionChanged();
+    void qualityChanged();
     void sourceChanged();
     void devicesChanged();
     void resolutionsChanged();
@@ -82,6 +87,7 @@ private:
     QString m_device;
     QString m_backend;
     QString m_resolution;
+    QString m_quality;
 
     QStringList m_deviceList;
     QStringList m_resolutionList;
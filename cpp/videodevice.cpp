@@ -12,6 +12,8 @@
 #include <unistd.h>
 #include <QDir>
 #include <QString>
+#include <algorithm>
+#include <functional>
 #include <iostream>
 
 namespace {
@@ -23,6 +25,43 @@ namespace {
         "3840x2160",
         "4096x2160"
     };
+
+    // Rates tried against stepwise or continuous frame interval ranges
+    const double commonFrameRates[] = { 120, 90, 60, 50, 30, 25, 15 };
+
+    // Frame rates the device offers for a format and size, fastest first
+    QList<double> frameRates(int fd, quint32 pixelFormat, quint32 width, quint32 height)
+    {
+        QList<double> rates;
+        struct v4l2_frmivalenum frmival = {};
+        frmival.pixel_format = pixelFormat;
+        frmival.width = width;
+        frmival.height = height;
+
+        for (frmival.index = 0; ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &frmival) == 0; frmival.index++) {
+            if (frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+                if (frmival.discrete.numerator == 0)
+                    continue;
+                rates.append((double)frmival.discrete.denominator / frmival.discrete.numerator);
+            } else {
+                // Stepwise and continuous ranges: min is the shortest interval
+                const struct v4l2_fract &fastest = frmival.stepwise.min;
+                const struct v4l2_fract &slowest = frmival.stepwise.max;
+                if (fastest.numerator == 0 || slowest.numerator == 0)
+                    break;
+                double maxRate = (double)fastest.denominator / fastest.numerator;
+                double minRate = (double)slowest.denominator / slowest.numerator;
+                for (double rate : commonFrameRates) {
+                    if (rate >= minRate && rate <= maxRate)
+                        rates.append(rate);
+                }
+                break;
+            }
+        }
+
+        std::sort(rates.begin(), rates.end(), std::greater<double>());
+        return rates;
+    }
 }
 
 VideoDevice::VideoDevice(QObject *parent)
@@ -107,13 +146,57 @@ void VideoDevice::enumerateDevices() {
     udev_enumerate_unref(enumerate);
 }
 
+void VideoDevice::enumerateModes(int fd)
+{
+    m_deviceModes.clear();
+    struct v4l2_fmtdesc fmtdesc = {};
+    fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    for (fmtdesc.index = 0; ioctl(fd, VIDIOC_ENUM_FMT, &fmtdesc) == 0; fmtdesc.index++) {
+        QList<QPair<quint32, quint32>> sizes;
+        struct v4l2_frmsizeenum frmsize = {};
+        frmsize.pixel_format = fmtdesc.pixelformat;
+
+        for (frmsize.index = 0; ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0; frmsize.index++) {
+            if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                sizes.append(qMakePair(frmsize.discrete.width, frmsize.discrete.height));
+            } else {
+                // Stepwise and continuous: the common resolutions inside the range
+                const struct v4l2_frmsize_stepwise &step = frmsize.stepwise;
+                qDebug() << "   Stepwise: " << step.min_width << "x" << step.min_height
+                        << " to " << step.max_width << "x" << step.max_height
+                        << " with step " << step.step_width << "x" << step.step_height;
+                for (const QString &res : commonResolutions) {
+                    quint32 w = res.section('x', 0, 0).toUInt();
+                    quint32 h = res.section('x', 1, 1).toUInt();
+                    if (w < step.min_width || w > step.max_width || h < step.min_height || h > step.max_height)
+                        continue;
+                    if ((step.step_width > 1 && (w - step.min_width) % step.step_width) ||
+                        (step.step_height > 1 && (h - step.min_height) % step.step_height))
+                        continue;
+                    sizes.append(qMakePair(w, h));
+                }
+                break;
+            }
+        }
+
+        for (const QPair<quint32, quint32> &size : sizes) {
+            QList<double> rates = frameRates(fd, fmtdesc.pixelformat, size.first, size.second);
+            if (rates.isEmpty())
+                rates.append(0);
+            for (double fps : rates)
+                m_deviceModes.append({ fmtdesc.pixelformat, size.first, size.second, fps });
+        }
+    }
+}
+
 QStringList VideoDevice::deviceResolution(QString device)
 {
     QStringList resolutions;
     try {
         qDebug() << "   Getting device resolution for: " << device;
-        const char *dev = device.toStdString().c_str();
-        int fd = open(dev, O_RDWR);
+        QByteArray dev = device.toLocal8Bit();
+        int fd = open(dev.constData(), O_RDWR);
         if (fd < 0) {
             throw std::runtime_error("Error opening device: " + device.toStdString());
         }
@@ -126,30 +209,31 @@ QStringList VideoDevice::deviceResolution(QString device)
             throw std::runtime_error("VIDIOC_G_FMT failed for device: " + device.toStdString());
         }
 
-        m_deviceResolution.clear();
-        struct v4l2_frmsizeenum frmsize = {};
-        frmsize.pixel_format = fmt.fmt.pix.pixelformat;
+        enumerateModes(fd);
+        close(fd);
 
-        for (frmsize.index = 0; ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0; frmsize.index++) {
-            if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
-                if(frmsize.discrete.width < 640 || frmsize.discrete.height < 480)
-                    continue;
-                QString currentRes = QString::number(frmsize.discrete.width) + "x" + QString::number(frmsize.discrete.height);
+        // The demos capture YUYV, list its modes unless the device lacks it
+        quint32 pixelFormat = V4L2_PIX_FMT_YUYV;
+        bool hasYuyv = std::any_of(m_deviceModes.begin(), m_deviceModes.end(),
+                                   [](const VideoMode &mode) { return mode.pixelFormat == V4L2_PIX_FMT_YUYV; });
+        if (!hasYuyv)
+            pixelFormat = fmt.fmt.pix.pixelformat;
+
+        m_deviceResolution.clear();
+        for (const VideoMode &mode : m_deviceModes) {
+            if (mode.pixelFormat != pixelFormat || mode.width < 640 || mode.height < 480)
+                continue;
+            QString currentRes = QString::number(mode.width) + "x" + QString::number(mode.height);
+            if (mode.fps > 0)
+                currentRes += "@" + QString::number(mode.fps, 'g', 4);
+            if (!m_deviceResolution.contains(currentRes))
                 m_deviceResolution.append(currentRes);
-            } else if (frmsize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
-                qDebug() << "   Stepwise: " << frmsize.stepwise.min_width << "x" << frmsize.stepwise.min_height
-                        << " to " << frmsize.stepwise.max_width << "x" << frmsize.stepwise.max_height
-                        << " with step " << frmsize.stepwise.step_width << "x" << frmsize.stepwise.step_height;
-                m_deviceResolution = commonResolutions;
-                break;
-            }
         }
 
-        close(fd);
         resolutions = m_deviceResolution;
     } catch (std::exception &e) {
         qDebug() << "Exception getting device resolution";
     }
 
     return resolutions;
-}
\ No newline at end of file
+}
@@ -17,6 +17,15 @@ class VideoDevice : public QObject {
     Q_OBJECT
 
 public:
+    //Capture mode a camera offers: pixel format, frame size and frame rate
+    //(0 when the driver does not enumerate frame intervals)
+    struct VideoMode {
+        quint32 pixelFormat;
+        quint32 width;
+        quint32 height;
+        double fps;
+    };
+
     VideoDevice(QObject *parent = nullptr);
     ~VideoDevice();
 
@@ -30,9 +39,11 @@ private slots:
 private:
 
     void enumerateDevices();
+    void enumerateModes(int fd);
 
     struct udev *udev;
     struct udev_monitor *monitor;
     QMap <QString, QString> m_devices;
     QList<QString> m_deviceResolution;
+    QList<VideoMode> m_deviceModes;
 };
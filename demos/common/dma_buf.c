@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/dma-heap.h>
+#include "dma_buf.h"
+
+//ioctl() restarted when a signal interrupts it
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+    int ret;
+
+    do {
+        ret = ioctl(fd, request, arg);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+int dma_heap_alloc(size_t size)
+{
+    static const char *const heaps[] = DMA_HEAPS;
+
+    for (size_t i = 0; i < sizeof(heaps) / sizeof(heaps[0]); i++) {
+        int heap = open(heaps[i], O_RDWR | O_CLOEXEC);
+        if (heap < 0) {
+            continue;
+        }
+        struct dma_heap_allocation_data data = {
+            .len = size,
+            .fd_flags = O_RDWR | O_CLOEXEC,
+        };
+        int ret = xioctl(heap, DMA_HEAP_IOCTL_ALLOC, &data);
+        close(heap);
+        if (ret == 0) {
+            return (int)data.fd;
+        }
+    }
+    return -1;
+}
+
+void dma_buf_sync(int fd, uint64_t flags)
+{
+    struct dma_buf_sync sync = {.flags = flags};
+    xioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
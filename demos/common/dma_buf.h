@@ -0,0 +1,30 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/dma-buf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//dma-buf helpers shared by the capture and the Wayland output buffers
+
+//dma-heaps tried in order by dma_heap_alloc(), physically contiguous first
+#define DMA_HEAPS {"/dev/dma_heap/linux,cma", "/dev/dma_heap/system"}
+
+//dma-buf of 'size' bytes from the first dma-heap that can provide it, -1 if none
+int dma_heap_alloc(size_t size);
+//Bracket CPU access to a dma-buf so caches are kept coherent with the device,
+//'flags' are DMA_BUF_SYNC_START or DMA_BUF_SYNC_END with READ and/or WRITE
+void dma_buf_sync(int fd, uint64_t flags);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "event_loop.h"
+
+//epoll data of the Wayland display fd, outside of the caller ids
+#define DISPLAY_SOURCE EVENT_LOOP_MAX_SOURCES
+
+static int watch(struct event_loop *loop, int fd, uint32_t id)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = id;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    return 0;
+}
+
+int event_loop_init(struct event_loop *loop, struct wl_display *display)
+{
+    loop->display = display;
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; i++) {
+        loop->timers[i] = -1;
+    }
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    if (display && watch(loop, wl_display_get_fd(display), DISPLAY_SOURCE) < 0) {
+        event_loop_close(loop);
+        return -1;
+    }
+    return 0;
+}
+
+int event_loop_add(struct event_loop *loop, int fd, unsigned int id)
+{
+    if (id >= EVENT_LOOP_MAX_SOURCES) {
+        fprintf(stderr, "Event source %u out of range\n", id);
+        return -1;
+    }
+    return watch(loop, fd, id);
+}
+
+int event_loop_add_timer(struct event_loop *loop, int period_ms, unsigned int id)
+{
+    if (id >= EVENT_LOOP_MAX_SOURCES) {
+        fprintf(stderr, "Event source %u out of range\n", id);
+        return -1;
+    }
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = period_ms / 1000;
+    spec.it_interval.tv_nsec = (long)(period_ms % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, NULL) < 0) {
+        perror("timerfd_settime");
+        close(fd);
+        return -1;
+    }
+    if (watch(loop, fd, id) < 0) {
+        close(fd);
+        return -1;
+    }
+    loop->timers[id] = fd;
+    return 0;
+}
+
+int event_loop_wait(struct event_loop *loop, uint32_t *ready)
+{
+    struct epoll_event events[EVENT_LOOP_MAX_SOURCES + 1];
+    struct wl_display *display = loop->display;
+    bool display_ready = false;
+    int n;
+
+    //Announce the intent to read, events already queued are dispatched first
+    //so that nothing is left behind while sleeping
+    if (display) {
+        while (wl_display_prepare_read(display) != 0) {
+            if (wl_display_dispatch_pending(display) < 0) {
+                perror("wl_display_dispatch_pending");
+                return -1;
+            }
+        }
+        //A full socket (EAGAIN) is flushed again on the next turn
+        if (wl_display_flush(display) < 0 && errno != EAGAIN) {
+            perror("wl_display_flush");
+            wl_display_cancel_read(display);
+            return -1;
+        }
+    }
+
+    do {
+        n = epoll_wait(loop->epfd, events, EVENT_LOOP_MAX_SOURCES + 1, -1);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        perror("epoll_wait");
+        if (display) {
+            wl_display_cancel_read(display);
+        }
+        return -1;
+    }
+
+    *ready = 0;
+    for (int i = 0; i < n; i++) {
+        uint32_t id = events[i].data.u32;
+        if (id == DISPLAY_SOURCE) {
+            display_ready = true;
+            continue;
+        }
+        //Consume the expirations, the timer would stay readable otherwise
+        if (loop->timers[id] >= 0) {
+            uint64_t expirations;
+            if (read(loop->timers[id], &expirations, sizeof(expirations)) < 0) {
+                continue;
+            }
+        }
+        *ready |= EVENT_SOURCE(id);
+    }
+
+    if (display) {
+        if (!display_ready) {
+            wl_display_cancel_read(display);
+        } else if (wl_display_read_events(display) < 0) {
+            perror("wl_display_read_events");
+            return -1;
+        }
+        if (wl_display_dispatch_pending(display) < 0) {
+            perror("wl_display_dispatch_pending");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void event_loop_close(struct event_loop *loop)
+{
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; i++) {
+        if (loop->timers[i] >= 0) {
+            close(loop->timers[i]);
+            loop->timers[i] = -1;
+        }
+    }
+    if (loop->epfd >= 0) {
+        close(loop->epfd);
+        loop->epfd = -1;
+    }
+}
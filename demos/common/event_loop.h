@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <wayland-client.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Single threaded epoll loop of the backends. The camera, the angle message
+//queue and timers are watched together with the Wayland display, the
+//caller handles each source the moment epoll reports it.
+
+//Sources watched at once, Wayland display included
+#define EVENT_LOOP_MAX_SOURCES 8
+//Bit of source 'id' in the mask returned by event_loop_wait()
+#define EVENT_SOURCE(id) (1u << (id))
+
+struct event_loop {
+    int epfd;
+    struct wl_display *display;     //Events read and dispatched by event_loop_wait(), NULL if none
+    int timers[EVENT_LOOP_MAX_SOURCES];   //timerfd of each source id, -1 for other fds
+};
+
+//Create the epoll instance, 'display' may be NULL
+int event_loop_init(struct event_loop *loop, struct wl_display *display);
+//Watch 'fd' for input, reported as source 'id' (0 to EVENT_LOOP_MAX_SOURCES - 1)
+int event_loop_add(struct event_loop *loop, int fd, unsigned int id);
+//Periodic timer reported as source 'id', the expirations are consumed by the loop
+int event_loop_add_timer(struct event_loop *loop, int period_ms, unsigned int id);
+//Flush the display, sleep until at least one fd is ready, then read and
+//dispatch the Wayland events. '*ready' gets the EVENT_SOURCE() bits of the
+//other sources, 0 when only Wayland events arrived. Returns -1 when the
+//display connection fails.
+int event_loop_wait(struct event_loop *loop, uint32_t *ready);
+//Close the epoll instance and the timers, the other fds belong to the caller
+void event_loop_close(struct event_loop *loop);
+
+#ifdef __cplusplus
+}
+#endif
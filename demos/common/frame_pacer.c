@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <string.h>
+#include "frame_pacer.h"
+
+//The compositor wants the next frame
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct frame_pacer *pacer = data;
+
+    wl_callback_destroy(callback);
+    pacer->callback = NULL;
+    pacer->waiting = false;
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+void frame_pacer_init(struct frame_pacer *pacer, bool enabled)
+{
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->enabled = enabled;
+}
+
+bool frame_pacer_ready(const struct frame_pacer *pacer)
+{
+    return !pacer->waiting;
+}
+
+void frame_pacer_begin(struct frame_pacer *pacer)
+{
+    pacer->waiting = pacer->enabled;
+}
+
+void frame_pacer_commit(struct frame_pacer *pacer, struct wl_surface *surface)
+{
+    if (!pacer->enabled) {
+        return;
+    }
+    pacer->callback = wl_surface_frame(surface);
+    wl_callback_add_listener(pacer->callback, &frame_listener, pacer);
+}
+
+void frame_pacer_destroy(struct frame_pacer *pacer)
+{
+    if (pacer->callback) {
+        wl_callback_destroy(pacer->callback);
+        pacer->callback = NULL;
+    }
+    pacer->waiting = false;
+}
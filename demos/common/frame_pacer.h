@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <wayland-client.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Presentation paced by wl_surface.frame callbacks. Once a frame is started
+//the next one waits until the compositor asks for it, so camera frames the
+//output would never show are not converted nor rotated: the backend keeps
+//the newest one and renders it when the callback arrives.
+
+struct frame_pacer {
+    bool enabled;               //false: every frame is rendered (commit every capture)
+    bool waiting;               //Frame started, its callback not received yet
+    struct wl_callback *callback;
+};
+
+void frame_pacer_init(struct frame_pacer *pacer, bool enabled);
+//True when a new frame may be rendered
+bool frame_pacer_ready(const struct frame_pacer *pacer);
+//A frame is being rendered, frame_pacer_ready() is false until its callback.
+//Call on the thread that dispatches the Wayland events.
+void frame_pacer_begin(struct frame_pacer *pacer);
+//Request the callback of the frame, right before the commit of 'surface'
+//(or eglSwapBuffers()). May be called from a rendering thread.
+void frame_pacer_commit(struct frame_pacer *pacer, struct wl_surface *surface);
+//Destroy a callback still pending
+void frame_pacer_destroy(struct frame_pacer *pacer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "g2d_capture.h"
+
+static int g2d_capture_init(struct g2d_capture *gc, unsigned int count)
+{
+    memset(gc, 0, sizeof(*gc));
+    gc->bufs = calloc(count, sizeof(*gc->bufs));
+    gc->fds = calloc(count, sizeof(*gc->fds));
+    if (!gc->bufs || !gc->fds) {
+        fprintf(stderr, "Out of memory for %u G2D capture buffers\n", count);
+        g2d_capture_free(gc);
+        return -1;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        gc->fds[i] = -1;
+    }
+    gc->count = count;
+    return 0;
+}
+
+int g2d_capture_alloc(struct g2d_capture *gc, unsigned int count, size_t size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (g2d_capture_init(gc, count) < 0) {
+        return -1;
+    }
+    size = (size + page - 1) & ~(page - 1);
+    for (unsigned int i = 0; i < count; i++) {
+        gc->bufs[i] = g2d_alloc((int)size, 0);
+        gc->fds[i] = gc->bufs[i] ? g2d_buf_export_fd(gc->bufs[i]) : -1;
+        if (gc->fds[i] < 0) {
+            fprintf(stderr, "Failed to allocate and export G2D capture buffer %u\n", i);
+            g2d_capture_free(gc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int g2d_capture_import(struct g2d_capture *gc, const struct capture *cap)
+{
+    if (g2d_capture_init(gc, cap->count) < 0) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < cap->count; i++) {
+        if (cap->buffers[i].dmabuf_fd >= 0) {
+            gc->bufs[i] = g2d_buf_from_fd(cap->buffers[i].dmabuf_fd);
+        }
+        if (!gc->bufs[i]) {
+            g2d_capture_free(gc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int g2d_capture_paddr(const struct g2d_capture *gc, unsigned int index)
+{
+    return gc->bufs[index]->buf_paddr;
+}
+
+void g2d_capture_free(struct g2d_capture *gc)
+{
+    for (unsigned int i = 0; i < gc->count; i++) {
+        if (gc->fds && gc->fds[i] >= 0) {
+            close(gc->fds[i]);
+        }
+        if (gc->bufs && gc->bufs[i]) {
+            g2d_free(gc->bufs[i]);
+        }
+    }
+    free(gc->bufs);
+    free(gc->fds);
+    memset(gc, 0, sizeof(*gc));
+}
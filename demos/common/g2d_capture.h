@@ -0,0 +1,45 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <g2d.h>
+#include "v4l2_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Camera buffers G2D reads in place, instead of copying every frame into a
+//g2d_alloc() source buffer. Either the capture buffers are G2D buffers
+//exported as dma-bufs and imported by the driver (DMABUF), or the dma-bufs
+//of the capture (exported MMAP buffers, dma-heap buffers) are imported
+//into G2D with g2d_buf_from_fd(), which only works for physically
+//contiguous buffers.
+
+struct g2d_capture {
+    struct g2d_buf **bufs;      //G2D buffer of each capture buffer, by index
+    int *fds;                   //g2d_capture_alloc(): exported dma-bufs, for capture_config.dmabuf_fds
+    unsigned int count;         //0 when the frames are copied
+};
+
+//Allocate 'count' G2D buffers of 'size' bytes and export them before
+//capture_open(), pass 'fds' as capture_config.dmabuf_fds with CAPTURE_DMABUF.
+//Returns -1 (with a message) on error, 'gc' is then freed.
+int g2d_capture_alloc(struct g2d_capture *gc, unsigned int count, size_t size);
+//Import the dma-bufs of an opened capture. Returns -1 if one of them cannot
+//be addressed by G2D, 'gc' is then freed and the frames must be copied.
+int g2d_capture_import(struct g2d_capture *gc, const struct capture *cap);
+//Physical address G2D reads buffer 'index' at
+int g2d_capture_paddr(const struct g2d_capture *gc, unsigned int index);
+//Free the G2D buffers and close the exported dma-bufs, after capture_close()
+void g2d_capture_free(struct g2d_capture *gc);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "latency.h"
+#include "presentation-time-client-protocol.h"
+
+//Indexed by enum latency_stage
+static const char *const stage_names[] = {"dequeue", "convert", "rotate", "commit", "present"};
+
+static int64_t now_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int compare_us(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//Rolling percentiles of every stage reached in the window
+static void report(struct latency *lat)
+{
+    static int64_t sorted[LATENCY_WINDOW];
+
+    printf("Latency %s (p50/p95/p99 ms over the last %d frames):", lat->backend, LATENCY_WINDOW);
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        unsigned int n = lat->window_count[stage];
+        if (n == 0) {
+            continue;
+        }
+        memcpy(sorted, lat->window[stage], n * sizeof(sorted[0]));
+        qsort(sorted, n, sizeof(sorted[0]), compare_us);
+        printf(" %s %.1f/%.1f/%.1f", stage_names[stage], sorted[(n - 1) * 50 / 100] / 1000.0,
+               sorted[(n - 1) * 95 / 100] / 1000.0, sorted[(n - 1) * 99 / 100] / 1000.0);
+    }
+    if (lat->discarded) {
+        printf(" (%lu discarded)", lat->discarded);
+    }
+    printf("\n");
+}
+
+//Account a frame whose last stage has been reached, called with the mutex held
+static void finish(struct latency_frame *frame)
+{
+    struct latency *lat = frame->lat;
+
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        if (frame->stage_us[stage] < 0) {
+            continue;
+        }
+        lat->window[stage][lat->window_pos[stage]] = frame->stage_us[stage];
+        lat->window_pos[stage] = (lat->window_pos[stage] + 1) % LATENCY_WINDOW;
+        if (lat->window_count[stage] < LATENCY_WINDOW) {
+            lat->window_count[stage]++;
+        }
+    }
+    if (lat->log) {
+        fprintf(lat->log, "%s,%u,%lld", lat->backend, frame->sequence, (long long)frame->capture_us);
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            fprintf(lat->log, ",%lld", (long long)frame->stage_us[stage]);
+        }
+        fprintf(lat->log, "\n");
+    }
+    frame->lat = NULL;
+
+    lat->finished++;
+    if (lat->report_interval > 0 && lat->finished % lat->report_interval == 0) {
+        report(lat);
+    }
+}
+
+static void presentation_clock_id(void *data, struct wp_presentation *presentation, uint32_t clk_id)
+{
+    struct latency *lat = data;
+    lat->presentation_monotonic = clk_id == CLOCK_MONOTONIC;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+    .clock_id = presentation_clock_id,
+};
+
+static void feedback_sync_output(void *data, struct wp_presentation_feedback *feedback, struct wl_output *output)
+{
+}
+
+static void feedback_presented(void *data, struct wp_presentation_feedback *feedback, uint32_t tv_sec_hi,
+                               uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh, uint32_t seq_hi,
+                               uint32_t seq_lo, uint32_t flags)
+{
+    struct latency_frame *frame = data;
+    struct latency *lat = frame->lat;
+
+    pthread_mutex_lock(&lat->mutex);
+    //Other clocks cannot be compared with the V4L2 timestamps
+    if (lat->presentation_monotonic) {
+        int64_t presented = (int64_t)(((uint64_t)tv_sec_hi << 32) | tv_sec_lo) * 1000000 + tv_nsec / 1000;
+        frame->stage_us[LATENCY_PRESENT] = presented - frame->capture_us;
+    }
+    wp_presentation_feedback_destroy(feedback);
+    frame->feedback = NULL;
+    finish(frame);
+    pthread_mutex_unlock(&lat->mutex);
+}
+
+static void feedback_discarded(void *data, struct wp_presentation_feedback *feedback)
+{
+    struct latency_frame *frame = data;
+    struct latency *lat = frame->lat;
+
+    pthread_mutex_lock(&lat->mutex);
+    lat->discarded++;
+    wp_presentation_feedback_destroy(feedback);
+    frame->feedback = NULL;
+    finish(frame);
+    pthread_mutex_unlock(&lat->mutex);
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+    .sync_output = feedback_sync_output,
+    .presented = feedback_presented,
+    .discarded = feedback_discarded,
+};
+
+int latency_init(struct latency *lat, const char *backend, int report_interval, const char *log_path)
+{
+    memset(lat, 0, sizeof(*lat));
+    lat->backend = backend;
+    lat->report_interval = report_interval;
+    lat->enabled = report_interval > 0 || log_path;
+    pthread_mutex_init(&lat->mutex, NULL);
+
+    if (log_path) {
+        lat->log = fopen(log_path, "w");
+        if (!lat->log) {
+            perror("Failed to create latency log");
+            return -1;
+        }
+        //Stage columns are microseconds after capture_us, -1 when not reached
+        fprintf(lat->log, "backend,sequence,capture_us");
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            fprintf(lat->log, ",%s_us", stage_names[stage]);
+        }
+        fprintf(lat->log, "\n");
+    }
+    return 0;
+}
+
+void latency_set_presentation(struct latency *lat, struct wp_presentation *presentation)
+{
+    if (!lat->enabled || !presentation) {
+        return;
+    }
+    lat->presentation = presentation;
+    wp_presentation_add_listener(presentation, &presentation_listener, lat);
+}
+
+struct latency_frame *latency_begin(struct latency *lat, const struct v4l2_buffer *buf)
+{
+    if (!lat->enabled) {
+        return NULL;
+    }
+    if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        lat->untimed++;
+        return NULL;
+    }
+
+    //Frames still being processed keep their slot (several cameras may have
+    //one each), the oldest other slot is reused
+    pthread_mutex_lock(&lat->mutex);
+    struct latency_frame *frame = NULL;
+    for (int i = 0; i < LATENCY_PENDING && !frame; i++) {
+        struct latency_frame *slot = &lat->frames[lat->next];
+        lat->next = (lat->next + 1) % LATENCY_PENDING;
+        if (!slot->lat || slot->feedback) {
+            frame = slot;
+        }
+    }
+    if (!frame) {
+        pthread_mutex_unlock(&lat->mutex);
+        return NULL;
+    }
+
+    //The compositor kept this frame's feedback too long, account it unpresented
+    if (frame->feedback) {
+        wp_presentation_feedback_destroy(frame->feedback);
+        frame->feedback = NULL;
+        finish(frame);
+    }
+
+    frame->lat = lat;
+    frame->sequence = buf->sequence;
+    frame->capture_us = (int64_t)buf->timestamp.tv_sec * 1000000 + buf->timestamp.tv_usec;
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        frame->stage_us[stage] = -1;
+    }
+    frame->stage_us[LATENCY_DEQUEUE] = now_us() - frame->capture_us;
+    pthread_mutex_unlock(&lat->mutex);
+    return frame;
+}
+
+void latency_stamp(struct latency_frame *frame, enum latency_stage stage)
+{
+    if (frame) {
+        frame->stage_us[stage] = now_us() - frame->capture_us;
+    }
+}
+
+void latency_commit(struct latency_frame *frame, struct wl_surface *surface)
+{
+    if (!frame) {
+        return;
+    }
+    struct latency *lat = frame->lat;
+
+    pthread_mutex_lock(&lat->mutex);
+    frame->stage_us[LATENCY_COMMIT] = now_us() - frame->capture_us;
+    if (lat->presentation) {
+        frame->feedback = wp_presentation_feedback(lat->presentation, surface);
+        wp_presentation_feedback_add_listener(frame->feedback, &feedback_listener, frame);
+    } else {
+        finish(frame);
+    }
+    pthread_mutex_unlock(&lat->mutex);
+}
+
+void latency_close(struct latency *lat)
+{
+    for (int i = 0; i < LATENCY_PENDING; i++) {
+        if (lat->frames[i].feedback) {
+            wp_presentation_feedback_destroy(lat->frames[i].feedback);
+            lat->frames[i].feedback = NULL;
+        }
+    }
+    if (lat->finished) {
+        report(lat);
+    }
+    if (lat->untimed) {
+        printf("Latency: %lu frames without a monotonic capture timestamp\n", lat->untimed);
+    }
+    if (lat->log) {
+        fclose(lat->log);
+        lat->log = NULL;
+    }
+    pthread_mutex_destroy(&lat->mutex);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <linux/videodev2.h>
+#include <wayland-client.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Glass to glass latency. Each frame carries the V4L2 capture timestamp
+//(CLOCK_MONOTONIC) through the pipeline, every stage is stamped on the same
+//clock, and wp_presentation feedback gives the time the frame reached the
+//screen when the compositor supports it.
+
+//Frames tracked at once, being processed or waiting for presentation feedback
+#define LATENCY_PENDING 8
+//Frames of the rolling window the percentiles are computed over
+#define LATENCY_WINDOW 256
+
+enum latency_stage {
+    LATENCY_DEQUEUE = 0,    //Buffer handed to the application
+    LATENCY_CONVERT,        //Camera frame converted, or copied to the blit source
+    LATENCY_ROTATE,         //Rotated frame ready
+    LATENCY_COMMIT,         //Frame committed to the compositor
+    LATENCY_PRESENT,        //Frame on screen (wp_presentation)
+    LATENCY_STAGE_COUNT,
+};
+
+struct wp_presentation;
+struct wp_presentation_feedback;
+struct latency;
+
+//One frame on its way to the screen
+struct latency_frame {
+    struct latency *lat;
+    uint32_t sequence;
+    int64_t capture_us;                     //v4l2_buffer.timestamp
+    int64_t stage_us[LATENCY_STAGE_COUNT];  //Time after capture_us, -1 if not reached
+    struct wp_presentation_feedback *feedback;
+};
+
+struct latency {
+    bool enabled;
+    const char *backend;
+    int report_interval;                    //Frames between two reports, 0 for none
+    FILE *log;                              //CSV log, NULL for none
+    pthread_mutex_t mutex;                  //Commit may run on a rotation thread
+
+    struct wp_presentation *presentation;
+    bool presentation_monotonic;            //Presentation clock is CLOCK_MONOTONIC
+
+    struct latency_frame frames[LATENCY_PENDING];
+    unsigned int next;
+
+    //Rolling window of each stage, in microseconds
+    int64_t window[LATENCY_STAGE_COUNT][LATENCY_WINDOW];
+    unsigned int window_count[LATENCY_STAGE_COUNT];
+    unsigned int window_pos[LATENCY_STAGE_COUNT];
+    unsigned long finished;
+    unsigned long discarded;                //Frames the compositor never showed
+    unsigned long untimed;                  //Frames without a monotonic capture timestamp
+};
+
+//Enabled when report_interval > 0 or a log path is given. Fails if the log
+//cannot be created.
+int latency_init(struct latency *lat, const char *backend, int report_interval, const char *log_path);
+//Use the wp_presentation global bound by the backend, NULL if not advertised
+void latency_set_presentation(struct latency *lat, struct wp_presentation *presentation);
+//Start tracking a dequeued frame, NULL when disabled or without a monotonic
+//timestamp. The latency_*() calls below accept NULL.
+struct latency_frame *latency_begin(struct latency *lat, const struct v4l2_buffer *buf);
+//Stamp 'stage' at the current time
+void latency_stamp(struct latency_frame *frame, enum latency_stage stage);
+//Stamp the commit and ask for presentation feedback, call right before the
+//wl_surface_commit() (or eglSwapBuffers()) of the frame
+void latency_commit(struct latency_frame *frame, struct wl_surface *surface);
+void latency_close(struct latency *lat);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "dma_buf.h"
+#include "output_buffers.h"
+
+//DRM format modifiers, as sent by linux-dmabuf: the buffers written here are linear
+#define MODIFIER_LINEAR 0ull
+#define MODIFIER_INVALID 0x00ffffffffffffffull
+
+static const char *const memory_names[] = {"shm", "dmabuf"};
+
+int output_memory_parse(const char *name, enum output_memory *memory)
+{
+    if (strcasecmp(name, "auto") == 0) {
+        *memory = OUTPUT_MEMORY_AUTO;
+        return 0;
+    }
+    for (int i = 0; i < (int)(sizeof(memory_names) / sizeof(memory_names[0])); i++) {
+        if (strcasecmp(name, memory_names[i]) == 0) {
+            *memory = (enum output_memory)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *output_memory_name(enum output_memory memory)
+{
+    return memory == OUTPUT_MEMORY_AUTO ? "auto" : memory_names[memory];
+}
+
+//Version 1 and 2 event: the format is importable with an implicit layout
+static void dmabuf_format(void *data, struct zwp_linux_dmabuf_v1 *dmabuf, uint32_t drm_format)
+{
+    struct output_formats *formats = data;
+    enum output_format format;
+
+    if (output_format_from_drm(drm_format, &format) == 0) {
+        formats->mask |= 1u << format;
+    }
+}
+
+static void dmabuf_modifier(void *data, struct zwp_linux_dmabuf_v1 *dmabuf, uint32_t drm_format,
+                            uint32_t modifier_hi, uint32_t modifier_lo)
+{
+    uint64_t modifier = ((uint64_t)modifier_hi << 32) | modifier_lo;
+
+    //Tiled or compressed layouts cannot be written by the CPU or G2D
+    if (modifier == MODIFIER_LINEAR || modifier == MODIFIER_INVALID) {
+        dmabuf_format(data, dmabuf, drm_format);
+    }
+}
+
+static const struct zwp_linux_dmabuf_v1_listener dmabuf_listener = {
+    .format = dmabuf_format,
+    .modifier = dmabuf_modifier,
+};
+
+void output_formats_listen_dmabuf(struct zwp_linux_dmabuf_v1 *dmabuf, struct output_formats *formats)
+{
+    formats->mask = 0;
+    zwp_linux_dmabuf_v1_add_listener(dmabuf, &dmabuf_listener, formats);
+}
+
+//The compositor is done reading the buffer
+static void buffer_release(void *data, struct wl_buffer *buffer)
+{
+    struct output_buffer *output = data;
+    output->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+int output_buffers_create(struct output_buffers *out, struct wl_shm *shm, unsigned int count,
+                          enum output_format format, int width, int height)
+{
+    int stride = output_format_stride(format, width);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    //Each buffer starts on a page, the renderers never share a cache line
+    size_t size = (output_format_size(format, width, height) + page - 1) & ~(page - 1);
+
+    memset(out, 0, sizeof(*out));
+    if (count == 0) {
+        count = OUTPUT_BUFFERS_DEFAULT;
+    }
+    if (count > OUTPUT_BUFFERS_MAX) {
+        fprintf(stderr, "At most %d output buffers are supported\n", OUTPUT_BUFFERS_MAX);
+        return -1;
+    }
+
+    int fd = memfd_create("wayland-shm", MFD_CLOEXEC);
+    if (fd < 0) {
+        perror("memfd_create failed");
+        return -1;
+    }
+    if (ftruncate(fd, size * count) < 0) {
+        perror("ftruncate failed");
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, size * count, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap failed");
+        close(fd);
+        return -1;
+    }
+    out->memory = OUTPUT_SHM;
+    out->data = data;
+    out->size = size * count;
+    out->buffer_size = size;
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, (int32_t)(size * count));
+    for (unsigned int i = 0; i < count; i++) {
+        struct output_buffer *output = &out->buffers[i];
+        output->data = (uint8_t *)data + size * i;
+        output->dmabuf_fd = -1;
+        output->buffer = wl_shm_pool_create_buffer(pool, (int32_t)(size * i), width, height, stride,
+                                                   output_format_shm(format));
+        wl_buffer_add_listener(output->buffer, &buffer_listener, output);
+    }
+    out->count = count;
+    out->width = width;
+    out->height = height;
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return 0;
+}
+
+static void params_created(void *data, struct zwp_linux_buffer_params_v1 *params, struct wl_buffer *buffer)
+{
+    struct output_buffer *output = data;
+    output->buffer = buffer;
+    wl_buffer_add_listener(buffer, &buffer_listener, output);
+}
+
+//The compositor cannot import the dma-buf, output->buffer stays NULL
+static void params_failed(void *data, struct zwp_linux_buffer_params_v1 *params)
+{
+}
+
+static const struct zwp_linux_buffer_params_v1_listener params_listener = {
+    .created = params_created,
+    .failed = params_failed,
+};
+
+int output_buffers_create_dmabuf(struct output_buffers *out, struct wl_display *display,
+                                 struct zwp_linux_dmabuf_v1 *dmabuf, unsigned int count, enum output_format format,
+                                 int width, int height, const int *fds, void *const *data)
+{
+    int stride = output_format_stride(format, width);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (output_format_size(format, width, height) + page - 1) & ~(page - 1);
+    struct zwp_linux_buffer_params_v1 *params[OUTPUT_BUFFERS_MAX] = {NULL};
+
+    memset(out, 0, sizeof(*out));
+    if (count == 0) {
+        count = OUTPUT_BUFFERS_DEFAULT;
+    }
+    if (count > OUTPUT_BUFFERS_MAX) {
+        fprintf(stderr, "At most %d output buffers are supported\n", OUTPUT_BUFFERS_MAX);
+        return -1;
+    }
+    out->memory = OUTPUT_DMABUF;
+    out->own_dmabufs = fds == NULL;
+    out->buffer_size = size;
+    out->width = width;
+    out->height = height;
+
+    for (unsigned int i = 0; i < count; i++) {
+        struct output_buffer *output = &out->buffers[i];
+        out->count = i + 1;
+        if (fds) {
+            output->dmabuf_fd = fds[i];
+            output->data = data[i];
+        } else {
+            output->dmabuf_fd = dma_heap_alloc(size);
+            if (output->dmabuf_fd < 0) {
+                fprintf(stderr, "No dma-heap can allocate %zu bytes\n", size);
+                output_buffers_destroy(out);
+                return -1;
+            }
+            output->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, output->dmabuf_fd, 0);
+            if (output->data == MAP_FAILED) {
+                perror("mmap dma-buf failed");
+                output->data = NULL;
+                output_buffers_destroy(out);
+                return -1;
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        struct output_buffer *output = &out->buffers[i];
+        params[i] = zwp_linux_dmabuf_v1_create_params(dmabuf);
+        zwp_linux_buffer_params_v1_add(params[i], output->dmabuf_fd, 0, 0, (uint32_t)stride,
+                                       (uint32_t)(MODIFIER_LINEAR >> 32), (uint32_t)MODIFIER_LINEAR);
+        if (format == OUTPUT_NV12) {
+            zwp_linux_buffer_params_v1_add(params[i], output->dmabuf_fd, 1, (uint32_t)stride * height,
+                                           (uint32_t)stride, (uint32_t)(MODIFIER_LINEAR >> 32),
+                                           (uint32_t)MODIFIER_LINEAR);
+        }
+        zwp_linux_buffer_params_v1_add_listener(params[i], &params_listener, output);
+        zwp_linux_buffer_params_v1_create(params[i], width, height, output_format_drm(format), 0);
+    }
+
+    //Every created or failed event arrives before the roundtrip completes
+    wl_display_roundtrip(display);
+    int ret = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        zwp_linux_buffer_params_v1_destroy(params[i]);
+        if (!out->buffers[i].buffer) {
+            ret = -1;
+        }
+    }
+    if (ret < 0) {
+        fprintf(stderr, "The compositor refused the %s dma-bufs\n", output_format_name(format));
+        output_buffers_destroy(out);
+    }
+    return ret;
+}
+
+struct output_buffer *output_buffers_acquire(struct output_buffers *out)
+{
+    for (unsigned int i = 0; i < out->count; i++) {
+        struct output_buffer *output = &out->buffers[(out->next + i) % out->count];
+        if (!output->busy) {
+            output->busy = true;
+            out->next = (out->next + i + 1) % out->count;
+            out->stats.frames++;
+            if (out->own_dmabufs) {
+                dma_buf_sync(output->dmabuf_fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+            }
+            return output;
+        }
+    }
+    out->stats.exhausted++;
+    return NULL;
+}
+
+//Smallest rectangle holding 'a' and 'b'
+static struct output_rect rect_union(const struct output_rect *a, const struct output_rect *b)
+{
+    struct output_rect r;
+    int x1 = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+    int y1 = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+
+    r.x = a->x < b->x ? a->x : b->x;
+    r.y = a->y < b->y ? a->y : b->y;
+    r.width = x1 - r.x;
+    r.height = y1 - r.y;
+    return r;
+}
+
+void output_buffers_attach(struct output_buffers *out, struct output_buffer *buffer, struct wl_surface *surface,
+                           const struct output_rect *content)
+{
+    struct output_rect full = {0, 0, out->width, out->height};
+    struct output_rect damage = full;
+
+    //CPU writes reach memory before the compositor imports the buffer
+    if (out->own_dmabufs) {
+        dma_buf_sync(buffer->dmabuf_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+    }
+    wl_surface_attach(surface, buffer->buffer, 0, 0);
+
+    if (!content) {
+        content = &full;
+    }
+    if (out->committed_valid) {
+        damage = rect_union(content, &out->committed);
+    }
+    out->committed = *content;
+    out->committed_valid = true;
+
+    wl_surface_damage_buffer(surface, damage.x, damage.y, damage.width, damage.height);
+    out->stats.pixels += (unsigned long long)out->width * out->height;
+    out->stats.damaged += (unsigned long long)damage.width * damage.height;
+}
+
+void output_buffers_invalidate(struct output_buffers *out)
+{
+    out->committed_valid = false;
+}
+
+void output_buffers_cancel(struct output_buffers *out, struct output_buffer *buffer)
+{
+    if (out->own_dmabufs) {
+        dma_buf_sync(buffer->dmabuf_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+    }
+    buffer->busy = false;
+}
+
+unsigned int output_buffers_index(const struct output_buffers *out, const struct output_buffer *buffer)
+{
+    return (unsigned int)(buffer - out->buffers);
+}
+
+unsigned int output_buffers_busy(const struct output_buffers *out)
+{
+    unsigned int busy = 0;
+    for (unsigned int i = 0; i < out->count; i++) {
+        busy += out->buffers[i].busy;
+    }
+    return busy;
+}
+
+void output_buffers_print_stats(const struct output_buffers *out)
+{
+    printf("Output (%s): %lu frames, %lu without a free buffer, %u/%u buffers busy, %.0f%% damaged\n",
+           output_memory_name(out->memory), out->stats.frames, out->stats.exhausted, output_buffers_busy(out), out->count,
+           out->stats.pixels ? 100.0 * out->stats.damaged / out->stats.pixels : 100.0);
+}
+
+void output_buffers_destroy(struct output_buffers *out)
+{
+    for (unsigned int i = 0; i < out->count; i++) {
+        struct output_buffer *output = &out->buffers[i];
+        if (output->buffer) {
+            wl_buffer_destroy(output->buffer);
+        }
+        if (out->own_dmabufs) {
+            if (output->data) {
+                munmap(output->data, out->buffer_size);
+            }
+            if (output->dmabuf_fd >= 0) {
+                close(output->dmabuf_fd);
+            }
+        }
+    }
+    if (out->data) {
+        munmap(out->data, out->size);
+    }
+    memset(out, 0, sizeof(*out));
+}
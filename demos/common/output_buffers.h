@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <wayland-client.h>
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "output_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Wayland output buffers of a window: wl_shm buffers carved from a single
+//memfd, or dma-bufs the compositor imports with zwp_linux_dmabuf_v1 and
+//reads in place. A buffer is handed to the renderer only while the
+//compositor is not reading it: it stays busy from output_buffers_acquire()
+//until wl_buffer.release, so a frame is never written over the one being
+//scanned out or uploaded.
+
+//Output buffers allocated when none are configured
+#define OUTPUT_BUFFERS_DEFAULT 3
+#define OUTPUT_BUFFERS_MAX 4
+
+//Memory of the output buffers
+enum output_memory {
+    OUTPUT_SHM = 0,             //memfd shared with the compositor, which copies every frame
+    OUTPUT_DMABUF,              //dma-bufs imported by the compositor, no copy
+    OUTPUT_MEMORY_AUTO = -1,    //dmabuf when the compositor supports the format, shm otherwise
+};
+
+//Rectangle of a buffer, in pixels
+struct output_rect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+struct output_buffer {
+    struct wl_buffer *buffer;
+    void *data;                 //CPU mapping, in the output format layout
+    int dmabuf_fd;              //OUTPUT_DMABUF: the buffer's dma-buf, -1 for shm
+    bool busy;                  //Acquired, or committed and not released yet
+};
+
+struct output_buffers_stats {
+    unsigned long frames;       //Buffers handed to the renderer
+    unsigned long exhausted;    //Acquires that found every buffer busy
+    unsigned long long pixels;  //Pixels of the frames committed
+    unsigned long long damaged; //Pixels of those frames submitted as damage
+};
+
+struct output_buffers {
+    struct output_buffer buffers[OUTPUT_BUFFERS_MAX];
+    unsigned int count;
+    unsigned int next;          //Buffer tried first by the next acquire
+    enum output_memory memory;
+    int width;
+    int height;
+    //Content of the last frame committed, background around it
+    struct output_rect committed;
+    bool committed_valid;
+    size_t buffer_size;         //Bytes of one buffer, page aligned
+    void *data;                 //OUTPUT_SHM: mapping of the whole memfd
+    size_t size;                //Bytes mapped
+    bool own_dmabufs;           //dma-bufs allocated here, unmapped and closed by destroy
+    struct output_buffers_stats stats;
+};
+
+//Parse "auto", "shm" or "dmabuf", -1 if unknown
+int output_memory_parse(const char *name, enum output_memory *memory);
+const char *output_memory_name(enum output_memory memory);
+
+//Collect the formats zwp_linux_dmabuf_v1 (version 3) accepts with a linear
+//layout into 'formats'. Call right after binding, the events arrive with
+//the next roundtrip.
+void output_formats_listen_dmabuf(struct zwp_linux_dmabuf_v1 *dmabuf, struct output_formats *formats);
+
+//Create 'count' (0 = OUTPUT_BUFFERS_DEFAULT) width x height wl_shm buffers
+//of 'format'. Returns -1 (with a message) on error, 'out' is then destroyed.
+int output_buffers_create(struct output_buffers *out, struct wl_shm *shm, unsigned int count,
+                          enum output_format format, int width, int height);
+//Same with linear dma-bufs. 'fds' and their CPU mappings 'data' belong to
+//the caller (e.g. exported G2D buffers), NULL allocates them from a dma-heap.
+//Waits for the compositor to accept every buffer. Returns -1 (with a
+//message) if one is refused or cannot be allocated, 'out' is then destroyed
+//and wl_shm buffers can be created instead.
+int output_buffers_create_dmabuf(struct output_buffers *out, struct wl_display *display,
+                                 struct zwp_linux_dmabuf_v1 *dmabuf, unsigned int count, enum output_format format,
+                                 int width, int height, const int *fds, void *const *data);
+//Take a free buffer to render into, NULL (counted) if the compositor still
+//holds all of them. The buffer stays busy until the compositor releases it
+//after a commit, or until output_buffers_cancel(). The CPU mapping of an
+//allocated dma-buf is synchronized for writing until it is attached.
+struct output_buffer *output_buffers_acquire(struct output_buffers *out);
+//Attach an acquired buffer to 'surface' for the next commit and submit its
+//damage. Its content covers 'content' and the rest is background (NULL: the
+//whole buffer changed): the damage is the content plus the area covered by
+//the previous frame, which is background now. The first frame is damaged whole.
+void output_buffers_attach(struct output_buffers *out, struct output_buffer *buffer, struct wl_surface *surface,
+                           const struct output_rect *content);
+//Damage the whole surface on the next attach, e.g. after its buffer
+//transform or viewport changed
+void output_buffers_invalidate(struct output_buffers *out);
+//Give back an acquired buffer that was not committed
+void output_buffers_cancel(struct output_buffers *out, struct output_buffer *buffer);
+//Index of a buffer of the set, e.g. to keep per buffer renderer state
+unsigned int output_buffers_index(const struct output_buffers *out, const struct output_buffer *buffer);
+//Buffers currently busy
+unsigned int output_buffers_busy(const struct output_buffers *out);
+//One line summary of the counters and occupancy
+void output_buffers_print_stats(const struct output_buffers *out);
+//Destroy the buffers and unmap them, safe on a zeroed or partially created set
+void output_buffers_destroy(struct output_buffers *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "output_format.h"
+
+//DRM fourcc code, see drm_fourcc.h
+#define DRM_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+static const struct {
+    const char *name;
+    uint32_t shm_format;
+    uint32_t drm_format;
+} formats_info[OUTPUT_FORMAT_COUNT] = {
+    [OUTPUT_ARGB8888] = {"argb8888", WL_SHM_FORMAT_ARGB8888, DRM_FOURCC('A', 'R', '2', '4')},
+    [OUTPUT_XRGB8888] = {"xrgb8888", WL_SHM_FORMAT_XRGB8888, DRM_FOURCC('X', 'R', '2', '4')},
+    [OUTPUT_RGB565] = {"rgb565", WL_SHM_FORMAT_RGB565, DRM_FOURCC('R', 'G', '1', '6')},
+    [OUTPUT_NV12] = {"nv12", WL_SHM_FORMAT_NV12, DRM_FOURCC('N', 'V', '1', '2')},
+};
+
+int output_format_parse(const char *name, enum output_format *format)
+{
+    if (strcmp(name, "auto") == 0) {
+        *format = OUTPUT_FORMAT_AUTO;
+        return 0;
+    }
+    for (int i = 0; i < OUTPUT_FORMAT_COUNT; i++) {
+        if (strcmp(name, formats_info[i].name) == 0) {
+            *format = (enum output_format)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *output_format_name(enum output_format format)
+{
+    return format >= 0 && format < OUTPUT_FORMAT_COUNT ? formats_info[format].name : "auto";
+}
+
+uint32_t output_format_shm(enum output_format format)
+{
+    return formats_info[format].shm_format;
+}
+
+uint32_t output_format_drm(enum output_format format)
+{
+    return formats_info[format].drm_format;
+}
+
+int output_format_from_drm(uint32_t drm_format, enum output_format *format)
+{
+    for (int i = 0; i < OUTPUT_FORMAT_COUNT; i++) {
+        if (formats_info[i].drm_format == drm_format) {
+            *format = (enum output_format)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int output_format_stride(enum output_format format, int width)
+{
+    switch (format) {
+    case OUTPUT_RGB565:
+        return width * 2;
+    case OUTPUT_NV12:
+        return width;
+    default:
+        return width * 4;
+    }
+}
+
+size_t output_format_size(enum output_format format, int width, int height)
+{
+    size_t stride = output_format_stride(format, width);
+
+    //NV12: the chroma plane follows the luma plane with the same stride
+    return format == OUTPUT_NV12 ? stride * (height + (height + 1) / 2) : stride * height;
+}
+
+static void shm_format(void *data, struct wl_shm *shm, uint32_t format)
+{
+    struct output_formats *formats = data;
+
+    for (int i = 0; i < OUTPUT_FORMAT_COUNT; i++) {
+        if (formats_info[i].shm_format == format) {
+            formats->mask |= 1u << i;
+        }
+    }
+}
+
+static const struct wl_shm_listener shm_listener = {
+    .format = shm_format,
+};
+
+void output_formats_listen(struct wl_shm *shm, struct output_formats *formats)
+{
+    //ARGB8888 and XRGB8888 are always supported by wl_shm
+    formats->mask = (1u << OUTPUT_ARGB8888) | (1u << OUTPUT_XRGB8888);
+    wl_shm_add_listener(shm, &shm_listener, formats);
+}
+
+int output_format_negotiate(const struct output_formats *formats, enum output_format requested,
+                            enum output_format *format)
+{
+    if (requested == OUTPUT_FORMAT_AUTO) {
+        *format = (formats->mask & (1u << OUTPUT_XRGB8888)) ? OUTPUT_XRGB8888 : OUTPUT_ARGB8888;
+        return 0;
+    }
+    if (!(formats->mask & (1u << requested))) {
+        fprintf(stderr, "Output format %s is not supported by the compositor\n", output_format_name(requested));
+        return -1;
+    }
+    *format = requested;
+    return 0;
+}
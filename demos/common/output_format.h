@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-client.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Output pixel formats of the Wayland sink, shared by the three backends
+enum output_format {
+    OUTPUT_ARGB8888 = 0,    //B, G, R, A in memory (original output)
+    OUTPUT_XRGB8888,        //Same layout, opaque: the compositor skips blending
+    OUTPUT_RGB565,          //Half the bytes written and read by the compositor
+    OUTPUT_NV12,            //Y plane + interleaved 4:2:0 UV plane, 1.5 bytes per pixel
+    OUTPUT_FORMAT_COUNT,
+    OUTPUT_FORMAT_AUTO = -1,
+};
+
+//Formats advertised by wl_shm, one bit per enum output_format
+struct output_formats {
+    uint32_t mask;
+};
+
+//Parse "auto", "argb8888", "xrgb8888", "rgb565" or "nv12", -1 if unknown
+int output_format_parse(const char *name, enum output_format *format);
+const char *output_format_name(enum output_format format);
+uint32_t output_format_shm(enum output_format format);
+//DRM fourcc of the format, used by linux-dmabuf
+uint32_t output_format_drm(enum output_format format);
+//Output format of a DRM fourcc, -1 if it is not one of them
+int output_format_from_drm(uint32_t drm_format, enum output_format *format);
+
+//Stride of the first plane and total size of a width x height buffer
+int output_format_stride(enum output_format format, int width);
+size_t output_format_size(enum output_format format, int width, int height);
+
+//Collect the wl_shm format events into 'formats'. Call right after binding
+//wl_shm, the events arrive with the next roundtrip.
+void output_formats_listen(struct wl_shm *shm, struct output_formats *formats);
+
+//Resolve 'requested' against the advertised formats. AUTO picks XRGB8888,
+//then ARGB8888. Returns -1 (with a message) if a forced format is missing.
+int output_format_negotiate(const struct output_formats *formats, enum output_format requested,
+                            enum output_format *format);
+
+#ifdef __cplusplus
+}
+#endif
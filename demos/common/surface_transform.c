@@ -0,0 +1,75 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <string.h>
+#include "surface_transform.h"
+
+//wl_output_transform of the buffer for each clockwise quarter turn: a buffer
+//transform states how the content is already rotated (counter-clockwise),
+//the compositor applies the inverse
+static const enum wl_output_transform transforms[] = {
+    WL_OUTPUT_TRANSFORM_NORMAL,
+    WL_OUTPUT_TRANSFORM_90,
+    WL_OUTPUT_TRANSFORM_180,
+    WL_OUTPUT_TRANSFORM_270,
+};
+
+void surface_transform_init(struct surface_transform *transform, bool enabled, struct wp_viewporter *viewporter,
+                            struct wl_surface *surface, int width, int height)
+{
+    memset(transform, 0, sizeof(*transform));
+    transform->enabled = enabled;
+    transform->width = width;
+    transform->height = height;
+    transform->quarters = -1;
+    if (enabled && viewporter) {
+        transform->viewport = wp_viewporter_get_viewport(viewporter, surface);
+    }
+}
+
+int surface_transform_split(int angle, int *residual)
+{
+    angle %= 360;
+    if (angle < 0) {
+        angle += 360;
+    }
+    int quarters = ((angle + 45) / 90) % 4;
+    *residual = angle - quarters * 90;
+    if (*residual >= 180) {
+        *residual -= 360;
+    }
+    return quarters;
+}
+
+bool surface_transform_set(struct surface_transform *transform, struct wl_surface *surface, int quarters)
+{
+    if (!transform->enabled || quarters == transform->quarters) {
+        return false;
+    }
+    wl_surface_set_buffer_transform(surface, transforms[quarters]);
+
+    //A quarter turned frame is height x width, scaled to fit the window
+    //height as the G2D backend does with its 90/270 degree band
+    if (transform->viewport) {
+        if (quarters % 2) {
+            wp_viewport_set_destination(transform->viewport,
+                                        transform->height * transform->height / transform->width,
+                                        transform->height);
+        } else {
+            wp_viewport_set_destination(transform->viewport, -1, -1);
+        }
+    }
+    transform->quarters = quarters;
+    return true;
+}
+
+void surface_transform_destroy(struct surface_transform *transform)
+{
+    if (transform->viewport) {
+        wp_viewport_destroy(transform->viewport);
+        transform->viewport = NULL;
+    }
+}
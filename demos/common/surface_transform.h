@@ -0,0 +1,44 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <wayland-client.h>
+#include "viewporter-client-protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Right angle part of the rotation done by the compositor. The frame is
+//submitted unrotated with wl_surface.set_buffer_transform, which the
+//compositor (or a display plane) applies while it composites anyway, and
+//wp_viewporter scales a quarter turned frame back to the window height.
+//The backend only rotates the residual angle, or nothing at all.
+
+struct surface_transform {
+    bool enabled;               //false: the backend does the whole rotation
+    struct wp_viewport *viewport;   //NULL without wp_viewporter, the frame is then shown unscaled
+    int width;                  //Window (and buffer) size
+    int height;
+    int quarters;               //Clockwise quarter turns set, -1 before the first frame
+};
+
+//'viewporter' may be NULL
+void surface_transform_init(struct surface_transform *transform, bool enabled, struct wp_viewporter *viewporter,
+                            struct wl_surface *surface, int width, int height);
+//Split a clockwise angle in degrees into the nearest quarter turns (0 to 3)
+//and the residual angle, in [-45, 45), left to the backend
+int surface_transform_split(int angle, int *residual);
+//Rotate the next commit of 'surface' by 'quarters' clockwise quarter turns.
+//Only sends requests when they change, true if they did.
+bool surface_transform_set(struct surface_transform *transform, struct wl_surface *surface, int quarters);
+void surface_transform_destroy(struct surface_transform *transform);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,477 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include "dma_buf.h"
+#include "v4l2_capture.h"
+
+//Indexed by enum capture_memory
+static const char *const memory_names[] = {"mmap", "userptr", "dmabuf"};
+static const enum v4l2_memory v4l2_memories[] = {V4L2_MEMORY_MMAP, V4L2_MEMORY_USERPTR, V4L2_MEMORY_DMABUF};
+
+int capture_memory_parse(const char *name, enum capture_memory *memory)
+{
+    for (int i = 0; i <= CAPTURE_DMABUF; i++) {
+        if (strcmp(name, memory_names[i]) == 0) {
+            *memory = (enum capture_memory)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *capture_memory_name(enum capture_memory memory)
+{
+    return memory_names[memory];
+}
+
+//ioctl() restarted when a signal interrupts it
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+    int ret;
+
+    do {
+        ret = ioctl(fd, request, arg);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+static int queue_buffer(struct capture *cap, unsigned int index, bool end_cpu_access)
+{
+    struct capture_buffer *b = &cap->buffers[index];
+    struct v4l2_buffer buf;
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = v4l2_memories[cap->memory];
+    buf.index = index;
+    if (cap->memory == CAPTURE_USERPTR) {
+        buf.m.userptr = (unsigned long)b->data;
+        buf.length = b->length;
+    } else if (cap->memory == CAPTURE_DMABUF) {
+        buf.m.fd = b->dmabuf_fd;
+        buf.length = b->length;
+        if (end_cpu_access) {
+            dma_buf_sync(b->dmabuf_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+        }
+    }
+    if (xioctl(cap->fd, VIDIOC_QBUF, &buf) < 0) {
+        perror("Failed to queue buffer");
+        return -1;
+    }
+    return 0;
+}
+
+//Allocate or map buffer 'index' for the configured memory
+static int setup_buffer(struct capture *cap, const struct capture_config *config, unsigned int index)
+{
+    struct capture_buffer *b = &cap->buffers[index];
+    size_t size = cap->format.fmt.pix.sizeimage;
+
+    switch (cap->memory) {
+    case CAPTURE_MMAP: {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+        if (xioctl(cap->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            perror("Failed to query buffer");
+            return -1;
+        }
+        b->data = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, cap->fd, buf.m.offset);
+        if (b->data == MAP_FAILED) {
+            b->data = NULL;
+            perror("Failed to mmap buffer");
+            return -1;
+        }
+        b->length = buf.length;
+
+        if (config->export_dmabuf) {
+            struct v4l2_exportbuffer expbuf;
+            memset(&expbuf, 0, sizeof(expbuf));
+            expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            expbuf.index = index;
+            expbuf.flags = O_RDONLY | O_CLOEXEC;
+            if (xioctl(cap->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+                perror("Failed to export buffer");
+                return -1;
+            }
+            b->dmabuf_fd = expbuf.fd;
+        }
+        return 0;
+    }
+    case CAPTURE_USERPTR: {
+        //Whole pages, some drivers map the buffer page by page
+        long page = sysconf(_SC_PAGESIZE);
+        b->length = (size + page - 1) & ~(size_t)(page - 1);
+        if (posix_memalign(&b->data, page, b->length) != 0) {
+            b->data = NULL;
+            fprintf(stderr, "Failed to allocate capture buffer\n");
+            return -1;
+        }
+        return 0;
+    }
+    case CAPTURE_DMABUF:
+        b->dmabuf_fd = config->dmabuf_fds ? config->dmabuf_fds[index] : dma_heap_alloc(size);
+        if (b->dmabuf_fd < 0) {
+            fprintf(stderr, "Failed to allocate a dma-buf for buffer %u\n", index);
+            return -1;
+        }
+        b->length = size;
+        b->data = mmap(NULL, size, PROT_READ, MAP_SHARED, b->dmabuf_fd, 0);
+        if (b->data == MAP_FAILED) {
+            b->data = NULL;
+            perror("Failed to mmap dma-buf");
+            return -1;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+//Ask for 'fps' frames per second (0 keeps the current rate), the driver
+//picks the nearest frame interval it supports. Only fails if the driver
+//rejects a rate it claims to support.
+static int set_frame_rate(struct capture *cap, double fps)
+{
+    struct v4l2_streamparm parm;
+
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(cap->fd, VIDIOC_G_PARM, &parm) < 0) {
+        if (fps > 0) {
+            fprintf(stderr, "Camera does not report its frame rate, %.2f fps not set\n", fps);
+        }
+        return 0;
+    }
+
+    struct v4l2_fract *interval = &parm.parm.capture.timeperframe;
+    if (fps > 0 && !(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+        fprintf(stderr, "Camera has a fixed frame rate, %.2f fps not set\n", fps);
+    } else if (fps > 0) {
+        interval->numerator = 1000;
+        interval->denominator = (uint32_t)(fps * 1000 + 0.5);
+        if (xioctl(cap->fd, VIDIOC_S_PARM, &parm) < 0) {
+            perror("Failed to set frame rate");
+            return -1;
+        }
+    }
+    cap->fps = interval->numerator ? (double)interval->denominator / interval->numerator : 0;
+
+    if (fps > 0 && cap->fps > 0 && (cap->fps < fps * 0.99 || cap->fps > fps * 1.01)) {
+        fprintf(stderr, "Camera runs at %.2f fps instead of %.2f\n", cap->fps, fps);
+    }
+    return 0;
+}
+
+int capture_open(struct capture *cap, const struct capture_config *config)
+{
+    memset(cap, 0, sizeof(*cap));
+    cap->memory = config->memory;
+    cap->latest = config->latest;
+    cap->inflight = config->inflight ? config->inflight : CAPTURE_INFLIGHT_DEFAULT;
+    cap->own_dmabufs = config->memory == CAPTURE_DMABUF && !config->dmabuf_fds;
+
+    cap->fd = open(config->device, O_RDWR | (config->nonblocking || config->latest ? O_NONBLOCK : 0));
+    if (cap->fd < 0) {
+        perror("Failed to open camera");
+        return -1;
+    }
+
+    //Streaming single planar capture only
+    struct v4l2_capability caps;
+    memset(&caps, 0, sizeof(caps));
+    if (xioctl(cap->fd, VIDIOC_QUERYCAP, &caps) < 0) {
+        perror("Failed to query capabilities");
+        capture_close(cap);
+        return -1;
+    }
+    uint32_t device_caps = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps : caps.capabilities;
+    if (!(device_caps & V4L2_CAP_VIDEO_CAPTURE) || !(device_caps & V4L2_CAP_STREAMING)) {
+        fprintf(stderr, "%s is not a streaming video capture device\n", config->device);
+        capture_close(cap);
+        return -1;
+    }
+
+    //Configure camera format
+    cap->format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    cap->format.fmt.pix.width = config->width;
+    cap->format.fmt.pix.height = config->height;
+    cap->format.fmt.pix.pixelformat = config->fourcc;
+    cap->format.fmt.pix.field = V4L2_FIELD_ANY;
+    if (xioctl(cap->fd, VIDIOC_S_FMT, &cap->format) < 0) {
+        perror("Failed to set format");
+        capture_close(cap);
+        return -1;
+    }
+    if ((int)cap->format.fmt.pix.width != config->width || (int)cap->format.fmt.pix.height != config->height) {
+        fprintf(stderr, "Camera does not support %dx%d (offers %ux%u)\n", config->width, config->height,
+                cap->format.fmt.pix.width, cap->format.fmt.pix.height);
+        capture_close(cap);
+        return -1;
+    }
+
+    //The frame interval depends on the format, set it once the format is final
+    if (set_frame_rate(cap, config->fps) < 0) {
+        capture_close(cap);
+        return -1;
+    }
+
+    //Request V4L2 buffers
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = config->buffers ? config->buffers : CAPTURE_BUFFERS_DEFAULT;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = v4l2_memories[cap->memory];
+    if (xioctl(cap->fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+        perror("Failed to request buffers");
+        capture_close(cap);
+        return -1;
+    }
+    if (config->dmabuf_fds && req.count != config->buffers) {
+        fprintf(stderr, "Driver wants %u buffers, %u dma-bufs given\n", req.count, config->buffers);
+        capture_close(cap);
+        return -1;
+    }
+
+    //The driver stalls once the application holds every buffer
+    if (cap->inflight >= req.count) {
+        fprintf(stderr, "%u in-flight buffers need more than the %u capture buffers\n", cap->inflight, req.count);
+        capture_close(cap);
+        return -1;
+    }
+
+    cap->buffers = calloc(req.count, sizeof(*cap->buffers));
+    cap->ring = calloc(req.count, sizeof(*cap->ring));
+    if (!cap->buffers || !cap->ring) {
+        fprintf(stderr, "Failed to allocate capture buffers\n");
+        capture_close(cap);
+        return -1;
+    }
+    for (unsigned int i = 0; i < req.count; i++) {
+        cap->buffers[i].dmabuf_fd = -1;
+    }
+    cap->count = req.count;
+
+    //Map or allocate, then queue every buffer
+    for (unsigned int i = 0; i < cap->count; i++) {
+        if (setup_buffer(cap, config, i) < 0 || queue_buffer(cap, i, false) < 0) {
+            capture_close(cap);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int capture_start(struct capture *cap)
+{
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (xioctl(cap->fd, VIDIOC_STREAMON, &type) < 0) {
+        perror("Failed to start streaming");
+        return -1;
+    }
+    cap->streaming = true;
+    return 0;
+}
+
+//A frame the driver flagged as corrupted or did not fill completely
+static bool buffer_torn(const struct capture *cap, const struct v4l2_buffer *buf)
+{
+    if (buf->flags & V4L2_BUF_FLAG_ERROR) {
+        return true;
+    }
+    //Some drivers leave bytesused at 0, only trust a non zero value
+    return buf->bytesused && buf->bytesused < cap->format.fmt.pix.sizeimage;
+}
+
+//Age of a frame from its V4L2 timestamp, -1 if the driver does not stamp
+//buffers with the monotonic clock
+static int64_t frame_age_us(const struct v4l2_buffer *buf)
+{
+    struct timespec now;
+
+    if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000 -
+           ((int64_t)buf->timestamp.tv_sec * 1000000 + buf->timestamp.tv_usec);
+}
+
+//Dequeue the next complete buffer, torn ones are requeued on the way
+static int dequeue_complete(struct capture *cap, struct v4l2_buffer *buf)
+{
+    while (1) {
+        memset(buf, 0, sizeof(*buf));
+        buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf->memory = v4l2_memories[cap->memory];
+        if (xioctl(cap->fd, VIDIOC_DQBUF, buf) < 0) {
+            if (errno != EAGAIN) {
+                perror("Failed to dequeue buffer");
+            }
+            return -1;
+        }
+
+        //Sequence numbers count every frame the driver captured, delivered or not
+        if (cap->sequence_valid) {
+            uint32_t gap = buf->sequence - cap->sequence - 1;
+            if (gap < 0x80000000u) {
+                cap->stats.dropped += gap;
+            }
+        }
+        cap->sequence = buf->sequence;
+        cap->sequence_valid = true;
+
+        if (!buffer_torn(cap, buf)) {
+            return 0;
+        }
+        cap->stats.torn++;
+        if (queue_buffer(cap, buf->index, false) < 0) {
+            return -1;
+        }
+    }
+}
+
+int capture_dequeue(struct capture *cap, struct v4l2_buffer *buf)
+{
+    if (cap->held >= cap->inflight) {
+        fprintf(stderr, "All %u in-flight capture buffers are held\n", cap->inflight);
+        return -1;
+    }
+    if (dequeue_complete(cap, buf) < 0) {
+        return -1;
+    }
+
+    //Latest mode: drain the queue, every older frame goes straight back
+    if (cap->latest) {
+        struct v4l2_buffer next;
+        while (dequeue_complete(cap, &next) == 0) {
+            cap->stats.skipped++;
+            if (queue_buffer(cap, buf->index, false) < 0) {
+                return -1;
+            }
+            *buf = next;
+        }
+        if (errno != EAGAIN) {
+            //Give the newest frame back, it is not held yet
+            int err = errno;
+            queue_buffer(cap, buf->index, false);
+            errno = err;
+            return -1;
+        }
+    }
+
+    int64_t age = frame_age_us(buf);
+    if (age >= 0) {
+        cap->stats.age_us = age;
+        cap->stats.age_total_us += age;
+        cap->stats.age_max_us = age > cap->stats.age_max_us ? age : cap->stats.age_max_us;
+        cap->stats.aged++;
+    }
+
+    if (cap->memory == CAPTURE_DMABUF) {
+        dma_buf_sync(cap->buffers[buf->index].dmabuf_fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+    }
+    cap->ring[cap->held++] = buf->index;
+    cap->stats.frames++;
+    return (int)buf->index;
+}
+
+int capture_queue(struct capture *cap, unsigned int index)
+{
+    unsigned int i = 0;
+
+    while (i < cap->held && cap->ring[i] != index) {
+        i++;
+    }
+    if (i == cap->held) {
+        fprintf(stderr, "Capture buffer %u is not held\n", index);
+        return -1;
+    }
+    memmove(&cap->ring[i], &cap->ring[i + 1], (cap->held - i - 1) * sizeof(*cap->ring));
+    cap->held--;
+    return queue_buffer(cap, index, true);
+}
+
+int capture_trim(struct capture *cap)
+{
+    while (cap->held >= cap->inflight) {
+        if (capture_queue(cap, cap->ring[0]) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void capture_print_stats(const struct capture *cap)
+{
+    const struct capture_stats *stats = &cap->stats;
+
+    printf("Capture: %lu frames, %lu dropped, %lu torn, %lu skipped, %u/%u buffers in flight", stats->frames,
+           stats->dropped, stats->torn, stats->skipped, cap->held, cap->inflight);
+    if (cap->fps > 0) {
+        printf(", camera at %.2f fps", cap->fps);
+    }
+    if (stats->aged) {
+        printf(", age %.1f ms (mean %.1f, max %.1f)", stats->age_us / 1000.0,
+               stats->age_total_us / 1000.0 / stats->aged, stats->age_max_us / 1000.0);
+    }
+    printf("\n");
+}
+
+void capture_close(struct capture *cap)
+{
+    if (cap->fd < 0) {
+        return;
+    }
+    if (cap->streaming) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(cap->fd, VIDIOC_STREAMOFF, &type);
+    }
+
+    for (unsigned int i = 0; i < cap->count; i++) {
+        struct capture_buffer *b = &cap->buffers[i];
+        if (cap->memory == CAPTURE_USERPTR) {
+            free(b->data);
+            continue;
+        }
+        if (b->data) {
+            munmap(b->data, b->length);
+        }
+        if (b->dmabuf_fd >= 0 && (cap->memory == CAPTURE_MMAP || cap->own_dmabufs)) {
+            close(b->dmabuf_fd);
+        }
+    }
+    free(cap->buffers);
+    free(cap->ring);
+
+    //Release the driver side of the buffers
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = v4l2_memories[cap->memory];
+    xioctl(cap->fd, VIDIOC_REQBUFS, &req);
+
+    close(cap->fd);
+    cap->fd = -1;
+    cap->buffers = NULL;
+    cap->ring = NULL;
+    cap->count = 0;
+    cap->held = 0;
+    cap->sequence_valid = false;
+    cap->streaming = false;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/videodev2.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//V4L2 capture shared by the demos: format negotiation, buffer allocation,
+//streaming and dma-buf export. Works with any single planar capture driver,
+//including vivid (modprobe vivid) for testing without a camera.
+
+//Capture buffers requested when none are configured
+#define CAPTURE_BUFFERS_DEFAULT 4
+//Buffers the application may hold at once when none are configured
+#define CAPTURE_INFLIGHT_DEFAULT 1
+
+//Buffer memory, see V4L2_MEMORY_*
+enum capture_memory {
+    CAPTURE_MMAP = 0,       //Driver buffers mapped into the process
+    CAPTURE_USERPTR,        //Page aligned buffers allocated by the process
+    CAPTURE_DMABUF,         //dma-buf fds given by the caller or allocated from a dma-heap
+};
+
+struct capture_config {
+    const char *device;
+    int width;
+    int height;
+    uint32_t fourcc;            //Requested V4L2_PIX_FMT_*, the driver may substitute another
+    unsigned int buffers;       //0 = CAPTURE_BUFFERS_DEFAULT, the driver may adjust it
+    unsigned int inflight;      //0 = CAPTURE_INFLIGHT_DEFAULT, must leave one buffer to the driver
+    enum capture_memory memory;
+    bool export_dmabuf;         //MMAP: export every buffer with VIDIOC_EXPBUF
+    const int *dmabuf_fds;      //DMABUF: 'buffers' fds to import, NULL = allocate from a dma-heap (DMA_HEAPS)
+    bool nonblocking;           //capture_dequeue() fails with EAGAIN instead of waiting for a frame
+    bool latest;                //Drain the queue on each dequeue and keep the newest frame, implies nonblocking
+    double fps;                 //Frame rate requested with VIDIOC_S_PARM, 0 = keep the driver's
+};
+
+struct capture_buffer {
+    void *data;                 //CPU mapping of the frame
+    size_t length;              //Bytes of the mapping
+    int dmabuf_fd;              //Exported or imported dma-buf, -1 if none
+};
+
+struct capture_stats {
+    unsigned long frames;       //Buffers handed to the application
+    unsigned long dropped;      //Frames the driver skipped, from gaps in the sequence numbers
+    unsigned long torn;         //Buffers flagged V4L2_BUF_FLAG_ERROR or short, requeued unseen
+    unsigned long skipped;      //Stale frames requeued unseen, by the latest mode or the application
+    //Frame age at dequeue time, from the monotonic V4L2 timestamps
+    unsigned long aged;         //Frames with a usable timestamp
+    int64_t age_us;             //Age of the last frame
+    int64_t age_max_us;
+    int64_t age_total_us;
+};
+
+struct capture {
+    int fd;
+    enum capture_memory memory;
+    struct v4l2_format format;  //Format negotiated with the driver
+    unsigned int count;         //Buffers granted by the driver
+    double fps;                 //Frame rate the driver runs at, 0 if it does not tell
+    struct capture_buffer *buffers;
+    //In-flight ring: buffers dequeued and not yet returned to the driver,
+    //oldest first. A buffer stays there until its consumer is done.
+    unsigned int *ring;
+    unsigned int held;
+    unsigned int inflight;      //Ring capacity
+    bool latest;
+    uint32_t sequence;          //Sequence number of the last buffer dequeued
+    bool sequence_valid;
+    struct capture_stats stats;
+    bool own_dmabufs;           //DMABUF fds allocated here, closed by capture_close()
+    bool streaming;
+};
+
+//Parse "mmap", "userptr" or "dmabuf", -1 if unknown
+int capture_memory_parse(const char *name, enum capture_memory *memory);
+const char *capture_memory_name(enum capture_memory memory);
+
+//Open the device, negotiate the format and frame rate, allocate and queue
+//every buffer. Fails if the driver does not accept the requested size, a
+//frame rate the driver cannot set or adjusts is only reported. Returns -1 (with
+//a message) on error, the capture is then closed.
+int capture_open(struct capture *cap, const struct capture_config *config);
+int capture_start(struct capture *cap);
+//Dequeue the next complete frame into the in-flight ring, returns its
+//buffer index or -1. Torn buffers are requeued and counted, never returned.
+//Fails if 'inflight' buffers are already held, or silently with errno EAGAIN
+//when a nonblocking capture has no frame ready. In latest mode every frame
+//already queued is dequeued, only the newest one is kept. The CPU mapping of
+//a dma-buf is synchronized for reading until the buffer is returned.
+int capture_dequeue(struct capture *cap, struct v4l2_buffer *buf);
+//Return held buffer 'index' to the driver, its consumer is done with it
+int capture_queue(struct capture *cap, unsigned int index);
+//Return the oldest held buffers until fewer than 'inflight' remain, so the
+//next capture_dequeue() has a slot. Only call once their consumers are done.
+int capture_trim(struct capture *cap);
+//One line summary of the frame counters, frame age and ring occupancy
+void capture_print_stats(const struct capture *cap);
+//Stop streaming and release everything, safe on a partially opened capture
+void capture_close(struct capture *cap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -22,7 +22,19 @@
 #include "xdg-shell-client-protocol.h"
 #include <mqueue.h>
 #include <sys/stat.h>
-#include <pthread.h>
+#include <getopt.h>
+#include <time.h>
+#include "output_format.h"
+#include "output_buffers.h"
+#include "v4l2_capture.h"
+#include "g2d_capture.h"
+#include "event_loop.h"
+#include "latency.h"
+#include "frame_pacer.h"
+#include "presentation-time-client-protocol.h"
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "viewporter-client-protocol.h"
+#include "surface_transform.h"
 
 
 
@@ -42,6 +54,43 @@ static int height = IMAGE_HEIGHT;
 //Global variable for angle capture
 int angle_deg;
 
+//Wayland output format (--format), resolved against the wl_shm formats
+static enum output_format output_format = OUTPUT_FORMAT_AUTO;
+static struct output_formats shm_formats;
+//Output buffers the frames rotate through and their memory (--output-buffers,
+//--output-memory): exported G2D buffers the blit writes into through
+//linux-dmabuf, or wl_shm buffers the blit result is copied to
+static unsigned int output_buffer_count = OUTPUT_BUFFERS_DEFAULT;
+static enum output_memory output_memory = OUTPUT_MEMORY_AUTO;
+static struct output_formats dmabuf_formats;
+
+//V4L2 capture buffers and frame rate (--buffers, --capture-memory, --inflight, --latest, --fps)
+static unsigned int capture_buffers = CAPTURE_BUFFERS_DEFAULT;
+static enum capture_memory capture_memory = CAPTURE_MMAP;
+static unsigned int capture_inflight = CAPTURE_INFLIGHT_DEFAULT;
+static bool capture_latest = false;
+static double capture_fps = 0;
+static int capture_stats_interval = 0;
+
+//Camera buffers read in place by G2D (--source=import), or copied into a
+//source buffer (--source=copy, or when G2D cannot address them)
+static bool source_import = true;
+static struct g2d_capture cam_g2d;
+
+//Presentation pacing (--pacing): render on wl_surface.frame callbacks or on
+//every camera frame
+static bool frame_pacing = true;
+static struct frame_pacer pacer;
+
+//Right angle rotations done by the compositor (--compositor-rotation)
+static bool compositor_rotation = false;
+static struct surface_transform transform;
+
+//Glass to glass latency report period and CSV log (--latency, --latency-log)
+static int latency_interval = 0;
+static const char *latency_log = NULL;
+static struct latency latency;
+
 //Wayland globals
 struct wl_display *display;
 struct wl_compositor *compositor;
@@ -50,6 +99,9 @@ struct xdg_wm_base *xdg_wm_base;
 struct xdg_toplevel *xdg_toplevel;
 struct wl_pointer *pointer;
 struct wl_seat *seat;
+struct wp_presentation *presentation;
+struct zwp_linux_dmabuf_v1 *dmabuf;
+struct wp_viewporter *viewporter;
 bool moving;
 uint32_t pointer_serial;
 int32_t pointer_x, pointer_y;
@@ -57,7 +109,35 @@ int32_t pointer_x, pointer_y;
 //libg2d globals
 struct g2d_surface src, dst;
 void *g2d_handle;
-struct g2d_buf *src_buf, *dst_buf;
+struct g2d_buf *output_bufs[OUTPUT_BUFFERS_MAX];
+
+//Blits in flight (--pipeline). g2d_finish() waits for everything submitted,
+//so with 2 the copy of the next camera frame overlaps the blit of the
+//previous one, which is committed once it is complete. Each blit has its
+//own source buffer, and its own dst_buf to copy from with shm.
+#define PIPELINE_MAX 2
+static unsigned int pipeline_depth = 1;
+struct g2d_buf *src_bufs[PIPELINE_MAX], *dst_bufs[PIPELINE_MAX];
+
+//A blit submitted to G2D, committed once complete
+struct blit {
+    struct output_buffer *output;
+    struct g2d_buf *copy_from;      //dst_buf copied into the shm buffer, NULL if G2D wrote the output
+    int cam_index;                  //Camera buffer read in place, held until the blit completes, -1 if copied
+    struct output_rect content;
+    int quarters;                   //--compositor-rotation turn of the frame
+    struct latency_frame *latency;
+    long long submit_ns;
+};
+
+//CPU and G2D time of the frames since the last report (--capture-stats)
+static struct {
+    unsigned long frames;
+    long long start_ns;             //Start of the period
+    long long cpu_ns;               //Copies, clears and blit submission
+    long long g2d_ns;               //Submission until completion was seen, at least the G2D time
+    long long wait_ns;              //Blocked in g2d_finish()
+} pipeline_stats;
 
 
 
@@ -167,63 +247,374 @@ static void registry_global(void *data, struct wl_registry *registry, uint32_t n
         }
     } else if (strcmp(interface, wl_shm_interface.name) == 0) {
         shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+        output_formats_listen(shm, &shm_formats);
+    } else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+        presentation = wl_registry_bind(registry, name, &wp_presentation_interface, 1);
+        latency_set_presentation(&latency, presentation);
+    } else if (strcmp(interface, zwp_linux_dmabuf_v1_interface.name) == 0 && version >= 3) {
+        dmabuf = wl_registry_bind(registry, name, &zwp_linux_dmabuf_v1_interface, 3);
+        output_formats_listen_dmabuf(dmabuf, &dmabuf_formats);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        viewporter = wl_registry_bind(registry, name, &wp_viewporter_interface, 1);
     }
 }
  
 static void registry_global_remove(void *data, struct wl_registry *registry, uint32_t name) {}
  
-//Buffer release listener
-static void buffer_release(void *data, struct wl_buffer *buffer) {
-    //Buffer is free to reuse
-}
- 
-static const struct wl_buffer_listener buffer_listener = {
-    .release = buffer_release,
+//Event loop sources
+enum {
+    SOURCE_CAMERA = 0,
+    SOURCE_MESSAGES,
+    SOURCE_WATCHDOG,
 };
+//Period of the camera watchdog, reports when no frame arrived in between
+#define WATCHDOG_MS 1000
 
-//Structure to pass data to the receiver thread (if needed)
-typedef struct {
-    mqd_t mq;
-} receiver_data_t;
- 
-//Receiver thread function
-void *receiver_thread(void *arg) {
-    receiver_data_t *data = (receiver_data_t *)arg;
-    mqd_t mq = data->mq;
-    char buffer[MAX_SIZE];
+//Read every pending angle message, returns 1 once the exit message arrived
+//and -1 if the queue failed
+static int read_angle_messages(mqd_t mq)
+{
+    char buffer[MAX_SIZE + 1];
     ssize_t bytes_read;
- 
-    printf("Receiver thread: Waiting for messages...\n");
- 
-    while (1) {
-        //Receive message from queue
-        bytes_read = mq_receive(mq, buffer, MAX_SIZE, NULL);
-        if (bytes_read == -1) {
-            perror("mq_receive");
-            break;
-        }
- 
+
+    while ((bytes_read = mq_receive(mq, buffer, MAX_SIZE, NULL)) >= 0) {
         buffer[bytes_read] = '\0'; // Null-terminate the string
-        angle_deg = atoi(buffer);
-        printf("Received angle: %i\n", angle_deg);
- 
+
         //Check if exit message is received
         if (strcmp(buffer, MSG_STOP) == 0) {
-            break;
+            return 1;
         }
+        angle_deg = atoi(buffer);
+        printf("Received angle: %i\n", angle_deg);
     }
-    printf("Receiver thread: Done\n");
-    pthread_exit(NULL);
+    if (errno != EAGAIN) {
+        perror("mq_receive");
+        return -1;
+    }
+    return 0;
 }
 
 
  
+static void print_usage(void)
+{
+    printf("Ussage: ./app, v4l2 device, width, height, angle [options]\n");
+    printf("Options:\n");
+    printf("  --quality=nearest|q8|q16|float  Accepted for all backends, G2D rotations are always exact\n");
+    printf("  --format=auto|argb8888|xrgb8888|rgb565|nv12\n");
+    printf("                                  Output pixel format (default: auto, xrgb8888 if available)\n");
+    printf("  --output-buffers=N              Wayland buffers the frames rotate through, 1 to %d (default: %d)\n",
+           OUTPUT_BUFFERS_MAX, OUTPUT_BUFFERS_DEFAULT);
+    printf("  --output-memory=auto|shm|dmabuf Wayland buffer memory, dmabuf blits straight into the buffers\n");
+    printf("                                  the compositor reads (default: auto, dmabuf if available)\n");
+    printf("  --buffers=N                     Camera buffers (default: %d)\n", CAPTURE_BUFFERS_DEFAULT);
+    printf("  --capture-memory=mmap|userptr|dmabuf\n");
+    printf("                                  Camera buffer memory (default: mmap)\n");
+    printf("  --inflight=N                    Camera buffers held while processing (default: %d)\n", CAPTURE_INFLIGHT_DEFAULT);
+    printf("  --capture-stats=N               Print captured, dropped and torn frames every N frames\n");
+    printf("  --latest                        Display only the newest camera frame, requeue the stale ones\n");
+    printf("  --fps=N                         Camera frame rate set with VIDIOC_S_PARM (default: the driver's)\n");
+    printf("  --pacing=frame|capture          Render on frame callbacks (default) or on every camera frame\n");
+    printf("  --source=import|copy            G2D reads the camera buffers in place (default) or a copy\n");
+    printf("  --pipeline=N                    G2D blits in flight, 2 overlaps the copy of a camera frame with\n");
+    printf("                                  the blit of the previous one (default: 1, at most %d)\n", PIPELINE_MAX);
+    printf("  --compositor-rotation           Submit unrotated frames, the compositor applies the 90/180/270\n");
+    printf("                                  degree turn (wl_surface buffer transform + wp_viewporter)\n");
+    printf("  --latency=N                     Print capture to screen latency percentiles every N frames\n");
+    printf("  --latency-log=FILE              Write the latency of every frame to a CSV file\n");
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//Wait until G2D completed every blit submitted, 'blit' is the newest one.
+//Returns the time blocked.
+static long long wait_blit(struct blit *blit)
+{
+    long long start = now_ns();
+    g2d_finish(g2d_handle);
+    long long end = now_ns();
+
+    pipeline_stats.wait_ns += end - start;
+    pipeline_stats.g2d_ns += end - blit->submit_ns;
+    latency_stamp(blit->latency, LATENCY_ROTATE);
+    return end - start;
+}
+
+//Hand the camera buffer a completed blit read in place back to the driver
+static int release_source(struct capture *cam, struct blit *blit)
+{
+    if (blit->cam_index < 0) {
+        return 0;
+    }
+    int ret = capture_queue(cam, (unsigned int)blit->cam_index);
+    blit->cam_index = -1;
+    return ret;
+}
+
+//Hand a completed blit to the compositor, the buffer is busy until it releases it
+static void present_blit(struct blit *blit, struct output_buffers *outputs, struct wl_surface *surface)
+{
+    //Copy image data from destination buffer into the shm buffer
+    if (blit->copy_from) {
+        memcpy(blit->output->data, blit->copy_from->buf_vaddr, output_format_size(output_format, width, height));
+    }
+    if (blit->quarters >= 0 && surface_transform_set(&transform, surface, blit->quarters)) {
+        output_buffers_invalidate(outputs);
+    }
+
+    //Only the blitted band and the previous one are damaged
+    frame_pacer_begin(&pacer);
+    output_buffers_attach(outputs, blit->output, surface, &blit->content);
+    latency_commit(blit->latency, surface);
+    frame_pacer_commit(&pacer, surface);
+    wl_surface_commit(surface);
+    wl_display_flush(display);
+}
+
+//Complete the blit in flight and commit it when no next frame can overlap
+//with it, then give its camera buffer back
+static int flush_blit(struct blit *blit, struct output_buffers *outputs, struct wl_surface *surface,
+                      struct capture *cam)
+{
+    wait_blit(blit);
+    present_blit(blit, outputs, surface);
+    return release_source(cam, blit);
+}
+
+static void print_pipeline_stats(void)
+{
+    long long now = now_ns();
+    double period = (double)(now - pipeline_stats.start_ns);
+    double frames = pipeline_stats.frames ? (double)pipeline_stats.frames : 1.0;
+
+    //With one blit in flight the G2D time is exact, with more it includes
+    //the time the finished blit waited for the next frame
+    printf("G2D pipeline (%u in flight): CPU %.2f ms/frame (%.0f%%), G2D <= %.2f ms/frame (%.0f%%), "
+           "waited %.2f ms/frame\n", pipeline_depth, pipeline_stats.cpu_ns / 1e6 / frames,
+           period > 0 ? 100.0 * pipeline_stats.cpu_ns / period : 0.0, pipeline_stats.g2d_ns / 1e6 / frames,
+           period > 0 ? 100.0 * pipeline_stats.g2d_ns / period : 0.0, pipeline_stats.wait_ns / 1e6 / frames);
+    memset(&pipeline_stats, 0, sizeof(pipeline_stats));
+    pipeline_stats.start_ns = now;
+}
+
+//G2D surface format written for each output format
+static enum g2d_format g2d_output_format(enum output_format format)
+{
+    switch (format) {
+    case OUTPUT_XRGB8888:
+        return G2D_RGBX8888;
+    case OUTPUT_RGB565:
+        return G2D_RGB565;
+    case OUTPUT_NV12:
+        return G2D_NV12;
+    default:
+        return G2D_RGBA8888;
+    }
+}
+
+//G2D surface format the YUYV camera frames are read as. The 32 bpp
+//formats are written in RGBA order while wl_shm expects BGRA, reading the
+//frames as YVYU swaps U and V and so cancels the R/B swap. RGB565 and NV12
+//match their wl_shm layout and are converted from the true YUYV order.
+static enum g2d_format g2d_source_format(enum output_format format)
+{
+    switch (format) {
+    case OUTPUT_RGB565:
+    case OUTPUT_NV12:
+        return G2D_YUYV;
+    default:
+        return G2D_YVYU;
+    }
+}
+
+//Clear the G2D output to white before a 90/270 blit leaves the sides uncovered
+static void clear_output(void *data, size_t size)
+{
+    if (output_format == OUTPUT_NV12) {
+        //Y plane to white, UV plane to neutral chroma
+        memset(data, 0xff, (size_t)width * height);
+        memset((uint8_t *)data + (size_t)width * height, 0x80, size - (size_t)width * height);
+        return;
+    }
+    memset(data, 0xff, size);
+}
+
+//Wrap 'count' G2D buffers as linux-dmabuf output buffers, the blit writes
+//into them and the compositor reads them without a copy
+static int create_dmabuf_outputs(struct output_buffers *outputs, unsigned int count, size_t size)
+{
+    int fds[OUTPUT_BUFFERS_MAX];
+    void *data[OUTPUT_BUFFERS_MAX];
+
+    if (count == 0) {
+        count = OUTPUT_BUFFERS_DEFAULT;
+    }
+    if (count > OUTPUT_BUFFERS_MAX) {
+        fprintf(stderr, "At most %d output buffers are supported\n", OUTPUT_BUFFERS_MAX);
+        return -1;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        output_bufs[i] = g2d_alloc((int)size, 0);
+        fds[i] = output_bufs[i] ? g2d_buf_export_fd(output_bufs[i]) : -1;
+        if (fds[i] < 0) {
+            fprintf(stderr, "Failed to export G2D output buffer\n");
+            for (unsigned int j = 0; j < i; j++) {
+                close(fds[j]);
+            }
+            return -1;
+        }
+        data[i] = output_bufs[i]->buf_vaddr;
+    }
+    if (output_buffers_create_dmabuf(outputs, display, dmabuf, count, output_format, width, height, fds, data) < 0) {
+        for (unsigned int i = 0; i < count; i++) {
+            close(fds[i]);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+//Free the G2D output buffers and their exported dma-bufs
+static void destroy_dmabuf_outputs(struct output_buffers *outputs)
+{
+    if (outputs->memory == OUTPUT_DMABUF) {
+        for (unsigned int i = 0; i < outputs->count; i++) {
+            close(outputs->buffers[i].dmabuf_fd);
+        }
+    }
+    for (unsigned int i = 0; i < OUTPUT_BUFFERS_MAX; i++) {
+        if (output_bufs[i]) {
+            g2d_free(output_bufs[i]);
+            output_bufs[i] = NULL;
+        }
+    }
+}
+
+//Parse the optional arguments following the positional ones
+static int parse_options(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"quality", required_argument, NULL, 'q'},
+        {"format", required_argument, NULL, 'f'},
+        {"output-buffers", required_argument, NULL, 'o'},
+        {"output-memory", required_argument, NULL, 'w'},
+        {"buffers", required_argument, NULL, 'n'},
+        {"capture-memory", required_argument, NULL, 'm'},
+        {"inflight", required_argument, NULL, 'r'},
+        {"capture-stats", required_argument, NULL, 'c'},
+        {"latest", no_argument, NULL, 'l'},
+        {"fps", required_argument, NULL, 'v'},
+        {"pacing", required_argument, NULL, 'u'},
+        {"compositor-rotation", no_argument, NULL, 'k'},
+        {"pipeline", required_argument, NULL, 'p'},
+        {"source", required_argument, NULL, 's'},
+        {"latency", required_argument, NULL, 'y'},
+        {"latency-log", required_argument, NULL, 'g'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    optind = 5;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'q':
+            //Multiples of 90 degrees never interpolate, nothing to select
+            if (strcmp(optarg, "nearest") != 0 && strcmp(optarg, "q8") != 0 &&
+                strcmp(optarg, "q16") != 0 && strcmp(optarg, "float") != 0) {
+                fprintf(stderr, "Unknown quality: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'f':
+            if (output_format_parse(optarg, &output_format) < 0) {
+                fprintf(stderr, "Unknown output format: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'o':
+            output_buffer_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            if (output_memory_parse(optarg, &output_memory) < 0) {
+                fprintf(stderr, "Unknown output memory: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'n':
+            capture_buffers = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (capture_memory_parse(optarg, &capture_memory) < 0) {
+                fprintf(stderr, "Unknown capture memory: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'r':
+            capture_inflight = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            capture_stats_interval = atoi(optarg);
+            break;
+        case 'l':
+            capture_latest = true;
+            break;
+        case 'v':
+            capture_fps = strtod(optarg, NULL);
+            break;
+        case 'u':
+            if (strcmp(optarg, "frame") == 0) {
+                frame_pacing = true;
+            } else if (strcmp(optarg, "capture") == 0) {
+                frame_pacing = false;
+            } else {
+                fprintf(stderr, "Unknown pacing: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'k':
+            compositor_rotation = true;
+            break;
+        case 's':
+            if (strcmp(optarg, "import") == 0) {
+                source_import = true;
+            } else if (strcmp(optarg, "copy") == 0) {
+                source_import = false;
+            } else {
+                fprintf(stderr, "Unknown source: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'p':
+            pipeline_depth = strtoul(optarg, NULL, 10);
+            if (pipeline_depth < 1 || pipeline_depth > PIPELINE_MAX) {
+                fprintf(stderr, "Pipeline depth must be 1 to %d\n", PIPELINE_MAX);
+                return -1;
+            }
+            break;
+        case 'y':
+            latency_interval = atoi(optarg);
+            break;
+        case 'g':
+            latency_log = optarg;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /************************ MAIN FUNCTION ******************************/
 int main(int argc, char *argv[]) 
 {
     //Verify arguments
-    if (argc != 5) {
-        printf("Ussage: ./app, v4l2 device, width, height, angle\n");
+    if (argc < 5) {
+        print_usage();
         return 1;
     }
     
@@ -232,16 +623,24 @@ int main(int argc, char *argv[])
     width = atoi(argv[2]);
     height = atoi(argv[3]);
     angle_deg = atoi(argv[4]);
+    if (parse_options(argc, argv) < 0) {
+        print_usage();
+        return 1;
+    }
+    if (latency_init(&latency, "g2d", latency_interval, latency_log) < 0) {
+        return 1;
+    }
 
     //Calculate rotate adjust value
     unsigned int rotate_adjust = (unsigned int)( (height*height)/(2*width) );
     int rotation_angle = 0;
+    //Blit target of each output buffer (each dst_buf with shm) holds the
+    //background around the 90/270 degree band
+    bool dst_background[OUTPUT_BUFFERS_MAX] = {false};
 
-    //Adding threads initialization for messageQ
+    //Initialization for messageQ, read by the event loop
     mqd_t mq;
     struct mq_attr attr;
-    pthread_t receiver_tid;
-    receiver_data_t receiver_data;
  
     //Initialize queue attributes
     attr.mq_flags = 0;
@@ -250,21 +649,11 @@ int main(int argc, char *argv[])
     attr.mq_curmsgs = 0;
  
     //Open the message queue
-    mq = mq_open(QUEUE_NAME, O_RDONLY, 0644, &attr);
+    mq = mq_open(QUEUE_NAME, O_RDONLY | O_NONBLOCK, 0644, &attr);
     if (mq == (mqd_t)-1) {
         perror("mq_open");
         exit(1);
     }
- 
-    //Prepare data for receiver thread
-    receiver_data.mq = mq;
- 
-    //Create the receiver thread
-    if (pthread_create(&receiver_tid, NULL, receiver_thread, &receiver_data) != 0) {
-        perror("pthread_create");
-        mq_close(mq);
-        exit(1);
-    }
 
     //Connect to Wayland display
     display = wl_display_connect(NULL);
@@ -289,125 +678,79 @@ int main(int argc, char *argv[])
     }
  
     xdg_wm_base_add_listener(xdg_wm_base, &xdg_wm_base_listener, NULL);
- 
-    //Open USB camera
-    int cam_fd = open(camera_device, O_RDWR);
-    if (cam_fd < 0) {
-        perror("Failed to open camera");
-        wl_display_disconnect(display);
-        return 1;
-    }
- 
-    //Configure camera format
-    struct v4l2_format fmt = {0};
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = width;
-    fmt.fmt.pix.height = height;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_ANY;
-    if (ioctl(cam_fd, VIDIOC_S_FMT, &fmt) < 0) {
-        perror("Failed to set format");
-        close(cam_fd);
-        wl_display_disconnect(display);
-        return 1;
-    }
- 
-    //Request V4L2 buffers
-    struct v4l2_requestbuffers req = {0};
-    req.count = 4;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    if (ioctl(cam_fd, VIDIOC_REQBUFS, &req) < 0) {
-        perror("Failed to request buffers");
-        close(cam_fd);
+
+    //Collect the wl_shm and linux-dmabuf formats, then pick the output format.
+    //It is negotiated against wl_shm, the fallback must be able to show it.
+    wl_display_roundtrip(display);
+    if (output_format_negotiate(&shm_formats, output_format, &output_format) < 0) {
         wl_display_disconnect(display);
         return 1;
     }
- 
-    //Map V4L2 buffers
-    void *cam_buffers[req.count];
-    struct v4l2_buffer buf;
-    size_t cam_buffer_lengths[req.count];
-    for (unsigned int i = 0; i < req.count; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        if (ioctl(cam_fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            perror("Failed to query buffer");
-            close(cam_fd);
-            wl_display_disconnect(display);
-            return 1;
-        }
-        cam_buffers[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, cam_fd, buf.m.offset);
-        cam_buffer_lengths[i] = buf.length;
-        if (cam_buffers[i] == MAP_FAILED) {
-            perror("Failed to mmap buffer");
-            close(cam_fd);
+    printf("Output format: %s\n", output_format_name(output_format));
+    if (output_memory != OUTPUT_SHM && !(dmabuf && (dmabuf_formats.mask & (1u << output_format)))) {
+        if (output_memory == OUTPUT_DMABUF) {
+            fprintf(stderr, "The compositor does not import %s dma-bufs\n", output_format_name(output_format));
             wl_display_disconnect(display);
             return 1;
         }
+        output_memory = OUTPUT_SHM;
     }
  
-    //Queue V4L2 buffers
-    for (unsigned int i = 0; i < req.count; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        if (ioctl(cam_fd, VIDIOC_QBUF, &buf) < 0) {
-            perror("Failed to queue buffer");
-            close(cam_fd);
-            wl_display_disconnect(display);
-            return 1;
-        }
+    //Camera buffers G2D reads in place: with dmabuf memory they are G2D
+    //buffers the driver imports, with mmap the driver buffers are exported
+    //and imported into G2D. A buffer read in place is held until its blit
+    //completes, one per blit in flight.
+    if (capture_buffers == 0) {
+        capture_buffers = CAPTURE_BUFFERS_DEFAULT;
     }
- 
-    //Start streaming
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(cam_fd, VIDIOC_STREAMON, &type) < 0) {
-        perror("Failed to start streaming");
-        close(cam_fd);
+    if (source_import && capture_memory == CAPTURE_DMABUF &&
+        g2d_capture_alloc(&cam_g2d, capture_buffers, (size_t)width * height * 2) < 0) {
         wl_display_disconnect(display);
         return 1;
     }
- 
-    //Create Wayland shared memory buffer
-    int stride = width * 4;
-    int size = stride * height;
- 
-    int shm_fd = memfd_create("wayland-shm", 0);
-    if (shm_fd < 0) {
-        perror("memfd_create failed");
-        close(cam_fd);
+
+    //Open USB camera
+    struct capture_config cam_config = {
+        .device = camera_device,
+        .width = width,
+        .height = height,
+        .fourcc = V4L2_PIX_FMT_YUYV,
+        .buffers = capture_buffers,
+        .memory = capture_memory,
+        .inflight = source_import && capture_inflight < pipeline_depth ? pipeline_depth : capture_inflight,
+        .export_dmabuf = source_import && capture_memory == CAPTURE_MMAP,
+        .dmabuf_fds = cam_g2d.count ? cam_g2d.fds : NULL,
+        .nonblocking = true,
+        .latest = capture_latest,
+        .fps = capture_fps,
+    };
+    struct capture cam;
+    if (capture_open(&cam, &cam_config) < 0) {
+        g2d_capture_free(&cam_g2d);
         wl_display_disconnect(display);
         return 1;
     }
-    if (ftruncate(shm_fd, size) < 0) {
-        perror("ftruncate failed");
-        close(shm_fd);
-        close(cam_fd);
+    if (cam.format.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV) {
+        fprintf(stderr, "Camera does not support YUYV\n");
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
         wl_display_disconnect(display);
         return 1;
     }
+    if (source_import && !cam_g2d.count && g2d_capture_import(&cam_g2d, &cam) < 0) {
+        fprintf(stderr, "G2D cannot address the camera buffers, copying the frames\n");
+    }
+    printf("Capture: %u %s buffers, %s\n", cam.count, capture_memory_name(cam.memory),
+           cam_g2d.count ? "read in place by G2D" : "copied for G2D");
  
-    void *shm_data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    if (shm_data == MAP_FAILED) {
-        perror("mmap failed");
-        close(shm_fd);
-        close(cam_fd);
+    //Start streaming
+    if (capture_start(&cam) < 0) {
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
         wl_display_disconnect(display);
         return 1;
     }
  
-    struct wl_shm_pool *pool = wl_shm_create_pool(shm, shm_fd, size);
-    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    close(shm_fd);
- 
-    //Add buffer listener
-    wl_buffer_add_listener(buffer, &buffer_listener, NULL);
- 
     //Create Wayland surface and xdg toplevel
     struct wl_surface *surface = wl_compositor_create_surface(compositor);
     struct xdg_surface *xdg_surface = xdg_wm_base_get_xdg_surface(xdg_wm_base, surface);
@@ -417,31 +760,56 @@ int main(int argc, char *argv[])
     xdg_toplevel_set_title(xdg_toplevel, "G2D Window");
     wl_surface_commit(surface);
  
-    //Initialize G2D
+    //Initialize G2D. From here on, errors unwind through the cleanup at the end.
+    int ret = 0;
+    struct output_buffers outputs = {0};
     if (g2d_open(&g2d_handle) != 0) {
         fprintf(stderr, "Failed to open G2D\n");
-        wl_buffer_destroy(buffer);
-        wl_surface_destroy(surface);
-        wl_display_disconnect(display);
-        return -1;
+        ret = 1;
+        goto close_capture;
     }
 
-    //Allocate source and destination buffers
-    src_buf = g2d_alloc(width * height * 2, 0);  //src_buf is YUV 16 bpp
-    dst_buf = g2d_alloc(width * height * 4, 0);  //dst_buf is RGBA 32 bpp
+    //Create the Wayland output buffers: G2D buffers shared with the compositor
+    //as dma-bufs, or wl_shm buffers when it cannot import them (unless forced)
+    int size = (int)output_format_size(output_format, width, height);
+    if (output_memory != OUTPUT_SHM && create_dmabuf_outputs(&outputs, output_buffer_count, size) < 0) {
+        destroy_dmabuf_outputs(&outputs);
+        if (output_memory == OUTPUT_DMABUF) {
+            ret = 1;
+            goto close_g2d;
+        }
+        fprintf(stderr, "Falling back to wl_shm output buffers\n");
+        output_memory = OUTPUT_SHM;
+    }
+    if (output_memory == OUTPUT_SHM &&
+        output_buffers_create(&outputs, shm, output_buffer_count, output_format, width, height) < 0) {
+        ret = 1;
+        goto close_g2d;
+    }
+    printf("Output memory: %s, %u buffers\n", output_memory_name(outputs.memory), outputs.count);
 
-    if (!src_buf || !dst_buf) {
+    //Allocate source and destination buffers of each blit in flight, src_buf
+    //is only needed to copy camera frames to and dst_buf (in the layout of
+    //the shm buffers) to copy from
+    bool allocated = true;
+    for (unsigned int i = 0; i < pipeline_depth; i++) {
+        if (!cam_g2d.count) {
+            src_bufs[i] = g2d_alloc(width * height * 2, 0);  //src_buf is YUV 16 bpp
+        }
+        if (outputs.memory == OUTPUT_SHM) {
+            dst_bufs[i] = g2d_alloc(size, 0);
+        }
+        allocated = allocated && (cam_g2d.count || src_bufs[i]) && (outputs.memory != OUTPUT_SHM || dst_bufs[i]);
+    }
+
+    if (!allocated) {
         fprintf(stderr, "Failed to allocate G2D buffers\n");
-        g2d_close(g2d_handle);
-        wl_buffer_destroy(buffer);
-        wl_surface_destroy(surface);
-        wl_display_disconnect(display);
-        return -1;
+        ret = 1;
+        goto close_g2d;
     }
 
-    //Configure source surface
-    src.format = G2D_YVYU;
-    src.planes[0] = src_buf->buf_paddr;
+    //Configure source surface, its plane follows the source buffer of each blit
+    src.format = g2d_source_format(output_format);
     src.left = 0;
     src.top = 0;
     src.right = width;
@@ -450,9 +818,8 @@ int main(int argc, char *argv[])
     src.width = width;
     src.height = height;
     src.rot = G2D_ROTATION_0;    
-    //Configure destination surface (use SHM buffer for output)
-    dst.format = G2D_RGBA8888;
-    dst.planes[0] = dst_buf->buf_paddr;  
+    //Configure destination surface, its planes follow the blit target of each frame
+    dst.format = g2d_output_format(output_format);
     dst.left = 0;
     dst.top = 0;
     dst.right = width;
@@ -461,89 +828,259 @@ int main(int argc, char *argv[])
     dst.width = width;
     dst.height = height;
 
+    //Event loop: camera frames, angle messages, camera watchdog and Wayland events
+    struct event_loop loop;
+    if (event_loop_init(&loop, display) < 0 || event_loop_add(&loop, cam.fd, SOURCE_CAMERA) < 0 ||
+        event_loop_add(&loop, mq, SOURCE_MESSAGES) < 0 || event_loop_add_timer(&loop, WATCHDOG_MS, SOURCE_WATCHDOG) < 0) {
+        event_loop_close(&loop);
+        ret = 1;
+        goto close_g2d;
+    }
+
     printf("\nInitializations completed (including G2D and messageQ),\nentering to the loop...\n");
 
-    //Main loop: capture and display frames
-    while (wl_display_dispatch(display) != -1) {
+    //Main loop: the newest camera frame is processed as soon as the
+    //compositor asks for a frame (on arrival with --pacing=capture)
+    frame_pacer_init(&pacer, frame_pacing);
+    surface_transform_init(&transform, compositor_rotation, viewporter, surface, width, height);
+    if (compositor_rotation && !viewporter) {
+        fprintf(stderr, "No wp_viewporter, quarter turned frames are shown unscaled\n");
+    }
+    unsigned long watchdog_frames = 0;
+    struct v4l2_buffer buf;
+    bool pending = false;
+    struct blit blits[PIPELINE_MAX];
+    unsigned int slot = 0;
+    bool inflight = false;
+    pipeline_stats.start_ns = now_ns();
+    uint32_t ready;
+    while (event_loop_wait(&loop, &ready) == 0) {
 
-        //Dequeue a frame
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        if (ioctl(cam_fd, VIDIOC_DQBUF, &buf) < 0) {
-            perror("Failed to dequeue buffer");
+        //Angle messages, the exit message ends the loop
+        if ((ready & EVENT_SOURCE(SOURCE_MESSAGES)) && read_angle_messages(mq) != 0) {
             break;
         }
-  
-        //Requeue the buffer
-        if (ioctl(cam_fd, VIDIOC_QBUF, &buf) < 0) {
-            perror("Failed to queue buffer");
-            break;
+
+        //Camera watchdog
+        if (ready & EVENT_SOURCE(SOURCE_WATCHDOG)) {
+            if (cam.stats.frames + cam.stats.torn == watchdog_frames) {
+                fprintf(stderr, "No frame from the camera for %d ms\n", WATCHDOG_MS);
+            }
+            watchdog_frames = cam.stats.frames + cam.stats.torn;
+
+            //No next frame to overlap with, commit the blit in flight
+            if (inflight && !pending) {
+                inflight = false;
+                if (flush_blit(&blits[slot ^ 1], &outputs, surface, &cam) < 0) {
+                    break;
+                }
+            }
+        }
+
+        //Dequeue the newest frame. Until the compositor asks for a frame it
+        //waits as the pending frame, a newer one replaces it and it goes back
+        //to the driver unseen.
+        if (ready & EVENT_SOURCE(SOURCE_CAMERA)) {
+            if (pending) {
+                pending = false;
+                cam.stats.skipped++;
+                if (capture_queue(&cam, buf.index) < 0) {
+                    break;
+                }
+            }
+            if (capture_dequeue(&cam, &buf) == 0) {
+                pending = true;
+                if (capture_stats_interval > 0 && cam.stats.frames % capture_stats_interval == 0) {
+                    capture_print_stats(&cam);
+                    output_buffers_print_stats(&outputs);
+                    print_pipeline_stats();
+                }
+            } else if (errno != EAGAIN) {
+                break;
+            }
+        }
+        if (!pending || !frame_pacer_ready(&pacer)) {
+            continue;
+        }
+        pending = false;
+
+        //Output buffer of the frame. When the compositor still holds all of
+        //them the frame is dropped before any work is spent on it. With a
+        //blit in flight holding the only free one, the blit is committed
+        //instead and the frame waits for the buffer the compositor releases.
+        struct output_buffer *output = output_buffers_acquire(&outputs);
+        if (!output && inflight) {
+            pending = true;
+            inflight = false;
+            if (flush_blit(&blits[slot ^ 1], &outputs, surface, &cam) < 0) {
+                break;
+            }
+            continue;
         }
+        if (!output) {
+            cam.stats.skipped++;
+            if (capture_queue(&cam, buf.index) < 0) {
+                break;
+            }
+            continue;
+        }
+        long long cpu_start = now_ns();
+        long long waited = 0;
+        struct blit *blit = &blits[slot];
+        blit->output = output;
+        blit->latency = latency_begin(&latency, &buf);
 
-        //Copy image data to source buffer
-        memcpy(src_buf->buf_vaddr, cam_buffers[buf.index], width * height * 2);
+        //Blit target: the output buffer itself, or the dst_buf of the slot copied into it
+        unsigned int target = slot;
+        struct g2d_buf *target_buf = dst_bufs[slot];
+        if (outputs.memory == OUTPUT_DMABUF) {
+            target = output_buffers_index(&outputs, output);
+            target_buf = output_bufs[target];
+        }
+        blit->copy_from = outputs.memory == OUTPUT_SHM ? target_buf : NULL;
+        dst.planes[0] = target_buf->buf_paddr;
+        if (output_format == OUTPUT_NV12) {
+            dst.planes[1] = target_buf->buf_paddr + width * height;
+        }
 
-        //Set rotation angle
+        //Blit source: the camera buffer itself, held until the blit
+        //completes, or a copy of it in the source buffer of the slot, and
+        //then the oldest buffers go back to the driver. A blit still in
+        //flight runs meanwhile.
+        blit->cam_index = -1;
+        if (cam_g2d.count) {
+            src.planes[0] = g2d_capture_paddr(&cam_g2d, buf.index);
+            blit->cam_index = (int)buf.index;
+        } else {
+            src.planes[0] = src_bufs[slot]->buf_paddr;
+            memcpy(src_bufs[slot]->buf_vaddr, cam.buffers[buf.index].data, width * height * 2);
+            if (capture_trim(&cam) < 0) {
+                break;
+            }
+        }
+        latency_stamp(blit->latency, LATENCY_CONVERT);
+
+        //Set rotation angle. With --compositor-rotation the quarter turns
+        //of the angle ranges go to the buffer transform and the blit only
+        //converts the whole frame, no band and no background to clear.
         rotation_angle = angle_deg%360;
+        blit->quarters = -1;
+        if (transform.enabled) {
+            blit->quarters = (rotation_angle + 360) % 360 / 90;
+            rotation_angle = 0;
+        }
 
         if ( (rotation_angle>=0 && rotation_angle<=89) || (rotation_angle<=-271 && rotation_angle>=-360) ){
             dst.rot = G2D_ROTATION_0;
             dst.left = 0;
             dst.right = width;
+            dst_background[target] = false;
         }
         else if ( (rotation_angle>=90 && rotation_angle<=179) || (rotation_angle<=-181 && rotation_angle>=-270) ){
             dst.rot = G2D_ROTATION_90;
             dst.left = (width/2)-rotate_adjust;
             dst.right = (width/2)+rotate_adjust;       
-            //Clear dst buffer (white background)
-            memset(dst_buf->buf_vaddr, 0xff, width * height * 4);
+            //Clear the target (white background), unless its last blit
+            //already left it around the same band
+            if (!dst_background[target]) {
+                clear_output(target_buf->buf_vaddr, size);
+                dst_background[target] = true;
+            }
         }
         else if ( (rotation_angle>=180 && rotation_angle<=269) || (rotation_angle<=-91 && rotation_angle>=-180) ){
             dst.rot = G2D_ROTATION_180;
             dst.left = 0;
             dst.right = width;
+            dst_background[target] = false;
         }
         else if ( (rotation_angle>=270 && rotation_angle<=359) || (rotation_angle<=-1 && rotation_angle>=-90) ){
             dst.rot = G2D_ROTATION_270;
             dst.left = (width/2)-rotate_adjust;
             dst.right = (width/2)+rotate_adjust;   
-            //Clear dst buffer (white background)
-            memset(dst_buf->buf_vaddr, 0xff, width * height * 4);
+            //Clear the target (white background), unless its last blit
+            //already left it around the same band
+            if (!dst_background[target]) {
+                clear_output(target_buf->buf_vaddr, size);
+                dst_background[target] = true;
+            }
         }
 
-        //Perform G2D blit (rotate into SHM buffer)
+        //Complete the blit in flight first: g2d_finish() waits for every
+        //blit submitted. The new blit is submitted before the previous one
+        //is committed, so the copy into its shm buffer runs meanwhile.
+        struct blit *previous = inflight ? &blits[slot ^ 1] : NULL;
+        if (previous) {
+            waited += wait_blit(previous);
+            if (release_source(&cam, previous) < 0) {
+                break;
+            }
+        }
+
+        //Perform G2D blit (rotate into the target), without waiting for it
+        blit->content = (struct output_rect){dst.left, dst.top, dst.right - dst.left, dst.bottom - dst.top};
+        blit->submit_ns = now_ns();
         g2d_blit(g2d_handle, &src, &dst);
-        g2d_finish(g2d_handle);        
+        g2d_flush(g2d_handle);
 
-        //Copy image data from destination buffer
-        memcpy(shm_data, dst_buf->buf_vaddr, width * height * 4);
-        
-        //Update Wayland surface
-        wl_surface_attach(surface, buffer, 0, 0);
-		wl_surface_damage(surface, 0, 0, width, height);
-        wl_surface_commit(surface);
-        wl_display_flush(display);
+        if (previous) {
+            present_blit(previous, &outputs, surface);
+        }
+        if (pipeline_depth == 1) {
+            waited += wait_blit(blit);
+            present_blit(blit, &outputs, surface);
+            if (release_source(&cam, blit) < 0) {
+                break;
+            }
+        } else {
+            inflight = true;
+            slot ^= 1;
+        }
+        pipeline_stats.frames++;
+        pipeline_stats.cpu_ns += now_ns() - cpu_start - waited;
     }
 
-    //Wait for the receiver thread to finish
-    if (pthread_join(receiver_tid, NULL) != 0) {
-        perror("pthread_join");
+    //The last blit in flight is never committed, let G2D finish with its buffers
+    if (inflight) {
+        g2d_finish(g2d_handle);
     }
- 
+
+    event_loop_close(&loop);
+    frame_pacer_destroy(&pacer);
+    surface_transform_destroy(&transform);
+
+    //Cleanup, also reached by the errors after the camera started
+close_g2d:
+    for (unsigned int i = 0; i < PIPELINE_MAX; i++) {
+        if (src_bufs[i]) {
+            g2d_free(src_bufs[i]);
+        }
+        if (dst_bufs[i]) {
+            g2d_free(dst_bufs[i]);
+        }
+    }
+    destroy_dmabuf_outputs(&outputs);
+    output_buffers_destroy(&outputs);
+    g2d_close(g2d_handle);
+close_capture:
+    capture_close(&cam);
+    g2d_capture_free(&cam_g2d);
+
     //Close the queue
     if (mq_close(mq) == -1) {
         perror("mq_close");
         exit(1);
     }
- 
-    //Cleanup
-    ioctl(cam_fd, VIDIOC_STREAMOFF, &type);
-    for (unsigned int i = 0; i < req.count; i++) {
-        munmap(cam_buffers[i], cam_buffer_lengths[i]);
-    }
-    close(cam_fd);
-    wl_buffer_destroy(buffer);
-    munmap(shm_data, size);
+
+    latency_close(&latency);
+    if (presentation) {
+        wp_presentation_destroy(presentation);
+    }
+    if (viewporter) {
+        wp_viewporter_destroy(viewporter);
+    }
+    if (dmabuf) {
+        zwp_linux_dmabuf_v1_destroy(dmabuf);
+    }
     xdg_toplevel_destroy(xdg_toplevel);
     xdg_surface_destroy(xdg_surface);
     wl_surface_destroy(surface);
@@ -553,5 +1090,5 @@ int main(int argc, char *argv[])
     wl_display_disconnect(display);
     wl_pointer_destroy(pointer);
     wl_seat_destroy(seat);
-    return 0;
+    return ret;
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "alloc_counter.hpp"
+
+#ifdef ALLOC_COUNTER
+#include <atomic>
+#include <errno.h>
+#include <stddef.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+static std::atomic<unsigned long> allocations(0);
+static thread_local int scope_depth;
+
+static inline void count_allocation(void)
+{
+    if (scope_depth > 0) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+alloc_scope::alloc_scope()
+{
+    scope_depth++;
+}
+
+alloc_scope::~alloc_scope()
+{
+    scope_depth--;
+}
+
+unsigned long alloc_count(void)
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+//Interposed allocation entry points, forwarded to glibc
+extern "C" {
+
+void *malloc(size_t size)
+{
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    count_allocation();
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    count_allocation();
+    void *p = __libc_memalign(alignment, size);
+    if (!p) {
+        return ENOMEM;
+    }
+    *memptr = p;
+    return 0;
+}
+
+}
+
+#endif
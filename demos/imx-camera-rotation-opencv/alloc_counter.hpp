@@ -0,0 +1,36 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+//Heap allocation counter, built in with "make ALLOC_COUNTER=1".
+//It interposes the glibc malloc family, so allocations made inside OpenCV
+//are seen too. Only allocations made while an alloc_scope is alive on the
+//calling thread are counted, which lets the frame processing be measured
+//without the Wayland and V4L2 calls around it.
+
+#ifdef ALLOC_COUNTER
+
+struct alloc_scope {
+    alloc_scope();
+    ~alloc_scope();
+};
+
+unsigned long alloc_count(void);
+
+static inline bool alloc_counter_enabled(void) { return true; }
+
+#else
+
+struct alloc_scope {
+    alloc_scope() {}
+};
+
+static inline unsigned long alloc_count(void) { return 0; }
+
+static inline bool alloc_counter_enabled(void) { return false; }
+
+#endif
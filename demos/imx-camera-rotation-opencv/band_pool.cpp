@@ -0,0 +1,164 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include "band_pool.hpp"
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+BandPool::BandPool(int threads, int bands, const std::vector<int> &cpus)
+    : m_bands(bands),
+      m_cpus(cpus),
+      m_rows(0),
+      m_next(0),
+      m_pending(0),
+      m_generation(0),
+      m_busy(false),
+      m_stop(false),
+      m_band_ns(bands, 0),
+      m_band_sum_ns(bands, 0),
+      m_stats_interval(0),
+      m_stats_frames(0)
+{
+    //The caller is thread 0, workers are 1..threads-1
+    if (!m_cpus.empty()) {
+        pin_thread(pthread_self(), m_cpus[0]);
+    }
+    for (int i = 1; i < threads; i++) {
+        m_workers.emplace_back(&BandPool::worker_loop, this);
+        if (!m_cpus.empty()) {
+            pin_thread(m_workers.back().native_handle(), m_cpus[i % m_cpus.size()]);
+        }
+    }
+}
+
+BandPool::~BandPool()
+{
+    wait_idle();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &t : m_workers) {
+        t.join();
+    }
+}
+
+void BandPool::pin_thread(pthread_t thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Failed to pin thread to CPU %d\n", cpu);
+    }
+}
+
+void BandPool::set_stats_interval(int interval)
+{
+    m_stats_interval = interval;
+}
+
+void BandPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return !m_busy; });
+}
+
+void BandPool::run(int rows, const rows_fn &job, const done_fn &done)
+{
+    wait_idle();
+
+    //Publish the frame, m_next is reset last so late workers of the previous
+    //frame can only ever claim bands of this one
+    m_job = job;
+    m_done = done;
+    m_rows = rows;
+    m_pending.store(m_bands, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy = true;
+        m_generation++;
+    }
+    m_next.store(0, std::memory_order_release);
+    m_wake.notify_all();
+
+    work();
+}
+
+void BandPool::worker_loop()
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+        }
+        work();
+    }
+}
+
+void BandPool::work()
+{
+    int band;
+    while ((band = m_next.fetch_add(1, std::memory_order_acq_rel)) < m_bands) {
+        int begin = (int)((long long)m_rows * band / m_bands);
+        int end = (int)((long long)m_rows * (band + 1) / m_bands);
+        long long start = now_ns();
+
+        m_job(begin, end);
+        m_band_ns[band] = now_ns() - start;
+
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            finish_frame();
+        }
+    }
+}
+
+void BandPool::finish_frame()
+{
+    if (m_stats_interval > 0) {
+        for (int i = 0; i < m_bands; i++) {
+            m_band_sum_ns[i] += m_band_ns[i];
+        }
+        if (++m_stats_frames == m_stats_interval) {
+            long long total = 0, slowest = 0;
+            printf("Band timing over %d frames (us/frame):", m_stats_frames);
+            for (int i = 0; i < m_bands; i++) {
+                long long avg = m_band_sum_ns[i] / m_stats_frames;
+                total += avg;
+                slowest = avg > slowest ? avg : slowest;
+                printf(" %lld", avg / 1000);
+                m_band_sum_ns[i] = 0;
+            }
+            //Imbalance: slowest band relative to the mean band
+            printf("  imbalance %.2f\n", total ? (double)slowest * m_bands / total : 0.0);
+            m_stats_frames = 0;
+        }
+    }
+
+    if (m_done) {
+        m_done();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy = false;
+    }
+    m_idle.notify_all();
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Persistent worker pool splitting each output frame into horizontal bands.
+//Bands are claimed dynamically, so bands that are mostly background at 45°
+//do not hold back the others. The calling thread works on bands too and
+//returns as soon as none are left; whichever thread finishes the last band
+//runs the frame's done() callback (e.g. the Wayland commit), so no thread
+//ever waits on a barrier inside a frame.
+class BandPool {
+public:
+    typedef std::function<void(int, int)> rows_fn;    //(row_begin, row_end)
+    typedef std::function<void()> done_fn;
+
+    //threads: total threads including the caller, cpus: optional affinity list
+    BandPool(int threads, int bands, const std::vector<int> &cpus);
+    ~BandPool();
+
+    //Start a frame of 'rows' rows. Waits for the previous frame first.
+    void run(int rows, const rows_fn &job, const done_fn &done);
+
+    //Block until the last frame's done() callback has returned
+    void wait_idle();
+
+    //Print per band timing every 'interval' frames (0 disables)
+    void set_stats_interval(int interval);
+
+    int threads() const { return (int)m_workers.size() + 1; }
+    int bands() const { return m_bands; }
+
+private:
+    void worker_loop();
+    void work();
+    void finish_frame();
+    static void pin_thread(pthread_t thread, int cpu);
+
+    int m_bands;
+    std::vector<std::thread> m_workers;
+    std::vector<int> m_cpus;
+
+    //Current frame, written by run() before m_next is reset
+    rows_fn m_job;
+    done_fn m_done;
+    int m_rows;
+    std::atomic<int> m_next;
+    std::atomic<int> m_pending;
+
+    //Wake up / idle signalling
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    unsigned m_generation;
+    bool m_busy;
+    bool m_stop;
+
+    //Per band timing (ns) of the current frame and running sums
+    std::vector<long long> m_band_ns;
+    std::vector<long long> m_band_sum_ns;
+    int m_stats_interval;
+    int m_stats_frames;
+};
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <opencv2/opencv.hpp>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include "benchmark.hpp"
+#include "rotate_kernels.hpp"
+#include "shear_rotate.hpp"
+#include "yuv_rotate.hpp"
+
+using namespace cv;
+
+//Same list as commonResolutions in cpp/videodevice.cpp, keep them in sync
+static const int bench_resolutions[][2] = {
+    {1024, 768},
+    {1280, 720},
+    {1920, 1080},
+    {2304, 1296},
+    {3840, 2160},
+    {4096, 2160},
+};
+
+//Arbitrary angles only, multiples of 90 take the exact kernels anyway
+static const int bench_angles[] = {10, 30, 45, 60};
+
+//Angle of the per format comparison of the fused kernels
+#define BENCH_FORMAT_ANGLE 30
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//Smooth synthetic frame with some chroma so every engine has real work to do
+static void fill_frame(std::vector<uint8_t> &yuyv, int w, int h)
+{
+    for (int y = 0; y < h; y++) {
+        uint8_t *row = yuyv.data() + (size_t)y * w * 2;
+        for (int x = 0; x < w; x += 2) {
+            row[x * 2] = (uint8_t)(16 + (x + y) % 220);
+            row[x * 2 + 1] = (uint8_t)(64 + x % 128);
+            row[x * 2 + 2] = (uint8_t)(16 + (x + 1 + y) % 220);
+            row[x * 2 + 3] = (uint8_t)(64 + y % 128);
+        }
+    }
+}
+
+//cvtColor + warpAffine, as the OpenCV backend originally did it
+static double bench_warp_affine(const std::vector<uint8_t> &yuyv, int w, int h, int angle, int frames)
+{
+    Mat yuvImage(h, w, CV_8UC2, (void *)yuyv.data());
+    Mat rgbaImage, rotated;
+    Point2f center(w / 2, h / 2);
+    Mat M = getRotationMatrix2D(center, 360 - (angle % 360), 1.0);
+
+    double start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        cvtColor(yuvImage, rgbaImage, COLOR_YUV2BGRA_YUYV);
+        warpAffine(rgbaImage, rotated, M, rgbaImage.size(), INTER_LINEAR, BORDER_CONSTANT, Scalar(0, 0, 0, 0xff));
+    }
+    return (now_ms() - start) / frames;
+}
+
+//Fused kernel at one interpolation quality, resampling only the spans. The
+//background is refilled every frame, as if the angle kept changing.
+static double bench_fused(void (*rows)(const struct fused_frame *, int, int), bool nearest,
+                          const std::vector<uint8_t> &yuyv, std::vector<uint8_t> &out, int w, int h, int angle, int frames)
+{
+    std::vector<struct rotate_span> spans(h);
+    struct fused_frame f = {yuyv.data(), w, h, w * 2, out.data(), w, h, w * 4, {}, spans.data()};
+    rotate_map_init(&f.map, w, h, angle);
+    rotate_spans_init(spans.data(), &f.map, w, h, w, h, nearest, 0);
+
+    double start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        rotate_fill_background(&f, 0, h);
+        rows(&f, 0, h);
+    }
+    return (now_ms() - start) / frames;
+}
+
+//Fused Q8 kernel of one source/destination format pair. The synthetic YUYV
+//bytes are read as the source format, only the work per pixel matters.
+static double bench_format(enum rotate_src_format src, enum rotate_dst_format dst, const std::vector<uint8_t> &yuyv,
+                           std::vector<uint8_t> &out, int w, int h, int frames)
+{
+    std::vector<struct rotate_span> spans(h);
+    int stride = rotate_src_stride(src, w);
+    int bpp = dst == DST_RGB565 ? 2 : 4;
+    struct fused_frame f = {yuyv.data(), w, h, stride, out.data(), w, h, w * bpp, {}, spans.data(),
+                            src, yuyv.data() + (size_t)stride * h, dst};
+    rotate_rows_fn rows = rotate_kernel_select(src, dst, QUALITY_Q8);
+    rotate_map_init(&f.map, w, h, BENCH_FORMAT_ANGLE);
+    rotate_spans_init(spans.data(), &f.map, w, h, w, h, false, 0);
+
+    double start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        rotate_fill_background(&f, 0, h);
+        rows(&f, 0, h);
+    }
+    return (now_ms() - start) / frames;
+}
+
+static double bench_shear(const std::vector<uint8_t> &yuyv, std::vector<uint8_t> &out, int w, int h, int angle, int frames)
+{
+    int tmp_width = shear_max_width(w, h);
+    std::vector<uint8_t> tmp1((size_t)tmp_width * h * 4);
+    std::vector<uint8_t> tmp2((size_t)tmp_width * h * 4);
+    struct shear_plan plan;
+    shear_plan_init(&plan, w, h, angle, false);
+    struct shear_frame f = {yuyv.data(), w, h, w * 2, tmp1.data(), tmp2.data(), tmp_width * 4, out.data(), w * 4, &plan};
+
+    double start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        shear_pass1_rows(&f, 0, h);
+        shear_pass2_rows(&f, 0, h);
+        shear_pass3_rows(&f, 0, h);
+    }
+    return (now_ms() - start) / frames;
+}
+
+//Each pass of the opencv engine (cvtColor, remap on BGRA) and of the yuv
+//engine (rotation into the Y/UV planes, convert), then the complete yuv engine
+struct remap_times {
+    double cvt;
+    double bgra;
+    double planes;
+    double convert;
+    double yuv;
+};
+
+//Time of the passes run per iteration, in ms per frame
+template <class Pass>
+static double time_pass(int frames, Pass pass)
+{
+    double start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        pass();
+    }
+    return (now_ms() - start) / frames;
+}
+
+static struct remap_times bench_yuv(RotationPlanCache &opencv_cache, RotationPlanCache &yuv_cache,
+                                    const std::vector<uint8_t> &yuyv, std::vector<uint8_t> &out, int w, int h, int angle,
+                                    int frames)
+{
+    struct remap_times t;
+    rotation_plan_ptr remap_plan = opencv_cache.get(w, h, angle);
+    rotation_plan_ptr plan = yuv_cache.get(w, h, angle);
+    Mat yuvImage(h, w, CV_8UC2, (void *)yuyv.data());
+    Mat output(h, w, CV_8UC4, (void *)out.data());
+    Mat rgbaImage;
+    cvtColor(yuvImage, rgbaImage, COLOR_YUV2BGRA_YUYV);
+
+    struct yuv_frame f;
+    yuv_frame_create(&f, w, h);
+    f.src = yuvImage;
+    f.dst = output;
+    f.plan = plan.get();
+    f.quality = QUALITY_Q8;
+    struct fused_frame bg = {yuyv.data(), w, h, w * 2, out.data(), w, h, w * 4, {}, plan->spans.data()};
+
+    t.cvt = time_pass(frames, [&] { cvtColor(yuvImage, rgbaImage, COLOR_YUV2BGRA_YUYV); });
+    t.bgra = time_pass(frames, [&] {
+        remap_spans(rgbaImage, output, remap_plan->map1, remap_plan->map2, remap_plan->spans.data(), 0, h, false,
+                    Scalar(0, 0, 0, 0xff));
+    });
+
+    //The convert pass reads the planes the rotation wrote
+    t.planes = time_pass(frames, [&] { yuv_rotate_rows(&f, 0, h); });
+    t.convert = time_pass(frames, [&] { yuv_convert_rows(&f, 0, h); });
+
+    t.yuv = time_pass(frames, [&] {
+        rotate_fill_background(&bg, 0, h);
+        yuv_rotate_rows(&f, 0, h);
+        yuv_convert_rows(&f, 0, h);
+    });
+    return t;
+}
+
+//Estimated bytes read + written per frame pixel by each pass, counted from
+//the buffers each pass touches, not measured: the remap maps are included
+//(CV_16SC2 + CV_16UC1: 6 bytes per sample), caches and background ignored,
+//every pass counted over the whole frame, an upper bound for the spans.
+#define BYTES_CVTCOLOR 6.0      //YUYV 2 -> BGRA 4
+#define BYTES_REMAP_BGRA 14.0   //BGRA 4 -> 4, maps 6
+#define BYTES_ROTATE_PLANES 3.5 //YUYV 2 -> Y 1 + 4:2:0 UV 0.5, Q16 map computed per pixel
+#define BYTES_CONVERT 5.5       //Y 1 + 4:2:0 UV 0.5 -> BGRA 4
+#define BYTES_OPENCV (BYTES_CVTCOLOR + BYTES_REMAP_BGRA)
+#define BYTES_YUV (BYTES_ROTATE_PLANES + BYTES_CONVERT)
+
+int run_benchmark(int frames)
+{
+    if (frames <= 0) {
+        fprintf(stderr, "Invalid frame count: %d\n", frames);
+        return 1;
+    }
+
+    setNumThreads(1);
+    printf("CPU engines, single thread, %d frames each, kernels: %s\n", frames, fused_kernel_name());
+    printf("%-11s %6s %12s %10s %10s %10s %10s %10s\n", "resolution", "angle", "warpAffine", "nearest", "q8", "q16", "shear", "yuv");
+
+    RotationPlanCache opencv_cache(256 << 20, ENGINE_OPENCV, QUALITY_FLOAT);
+    RotationPlanCache yuv_cache(64 << 20, ENGINE_YUV, QUALITY_Q8);
+    std::vector<struct remap_times> remaps;
+
+    for (const int *res : bench_resolutions) {
+        int w = res[0];
+        int h = res[1];
+        std::vector<uint8_t> yuyv((size_t)w * h * 2);
+        std::vector<uint8_t> out((size_t)w * h * 4);
+        fill_frame(yuyv, w, h);
+
+        for (int angle : bench_angles) {
+            double warp = bench_warp_affine(yuyv, w, h, angle, frames);
+            double nearest = bench_fused(fused_nearest_rows, true, yuyv, out, w, h, angle, frames);
+            double q8 = bench_fused(fused_rotate_rows, false, yuyv, out, w, h, angle, frames);
+            double q16 = bench_fused(fused_rotate_rows_q16, false, yuyv, out, w, h, angle, frames);
+            double shear = bench_shear(yuyv, out, w, h, angle, frames);
+            struct remap_times yuv = bench_yuv(opencv_cache, yuv_cache, yuyv, out, w, h, angle, frames);
+            remaps.push_back(yuv);
+            printf("%4dx%-6d %6d %9.2f ms %7.2f ms %7.2f ms %7.2f ms %7.2f ms %7.2f ms\n", w, h, angle, warp, nearest, q8, q16,
+                   shear, yuv.yuv);
+        }
+    }
+
+    //Passes of the opencv and yuv engines: measured times, and the memory
+    //traffic estimated above (not measured). est. GB/s is that estimate over
+    //the measured time, time the measured yuv time relative to opencv.
+    printf("\nopencv and yuv passes, estimated traffic: opencv %.1f bytes/pixel "
+           "(cvtColor %.1f + remap %.1f), yuv %.1f bytes/pixel (rotate %.1f + convert %.1f)\n",
+           BYTES_OPENCV, BYTES_CVTCOLOR, BYTES_REMAP_BGRA, BYTES_YUV, BYTES_ROTATE_PLANES, BYTES_CONVERT);
+    printf("%-11s %6s %10s %10s %10s %10s %9s %10s %10s %10s %10s %9s %9s\n", "resolution", "angle", "cvtColor",
+           "remap", "opencv", "est. MB", "est. GB/s", "rotate", "convert", "yuv", "est. MB", "est. GB/s", "time");
+    size_t i = 0;
+    for (const int *res : bench_resolutions) {
+        double pixels = (double)res[0] * res[1];
+        for (int angle : bench_angles) {
+            const struct remap_times &t = remaps[i++];
+            double opencv = t.cvt + t.bgra;
+            double yuv = t.planes + t.convert;
+            double opencv_mb = pixels * BYTES_OPENCV / 1e6;
+            double yuv_mb = pixels * BYTES_YUV / 1e6;
+            printf("%4dx%-6d %6d %7.2f ms %7.2f ms %7.2f ms %10.1f %9.1f %7.2f ms %7.2f ms %7.2f ms %10.1f %9.1f "
+                   "%8.0f%%\n", res[0], res[1], angle, t.cvt, t.bgra, opencv, opencv_mb,
+                   opencv > 0 ? opencv_mb / opencv : 0.0, t.planes, t.convert, yuv, yuv_mb,
+                   yuv > 0 ? yuv_mb / yuv : 0.0, opencv > 0 ? 100.0 * yuv / opencv : 0.0);
+        }
+    }
+
+    //Kernels instantiated per input/output format, BGRA output unless noted
+    printf("\nFused q8 kernel per format, %d degrees\n", BENCH_FORMAT_ANGLE);
+    printf("%-11s %10s %10s %10s %10s %12s\n", "resolution", "yuyv", "uyvy", "nv12", "grey", "yuyv>rgb565");
+    for (const int *res : bench_resolutions) {
+        int w = res[0];
+        int h = res[1];
+        std::vector<uint8_t> yuyv((size_t)w * h * 2);
+        std::vector<uint8_t> out((size_t)w * h * 4);
+        fill_frame(yuyv, w, h);
+
+        printf("%4dx%-6d", w, h);
+        for (int src = 0; src < SRC_FORMAT_COUNT; src++) {
+            printf(" %7.2f ms", bench_format((enum rotate_src_format)src, DST_BGRA, yuyv, out, w, h, frames));
+        }
+        printf(" %9.2f ms\n", bench_format(SRC_YUYV, DST_RGB565, yuyv, out, w, h, frames));
+    }
+    return 0;
+}
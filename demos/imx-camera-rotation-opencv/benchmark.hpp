@@ -0,0 +1,14 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+//Frames timed per (resolution, angle, engine) when none are given
+#define BENCH_FRAMES_DEFAULT 30
+
+//Time the CPU rotation engines (fused at each quality) on synthetic YUYV frames at every resolution
+//offered by the GUI, single threaded. Returns the process exit code.
+int run_benchmark(int frames);
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "frame_scheduler.hpp"
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+FrameScheduler::FrameScheduler(int threads, int bands, int streams, const std::vector<int> &cpus)
+    : m_bands(bands),
+      m_streams(streams),
+      m_jobs(new Job[streams]),
+      m_queued(0),
+      m_sleeping(0),
+      m_stop(false),
+      m_stats_interval(0),
+      m_stats_jobs(0)
+{
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd < 0) {
+        perror("eventfd");
+    }
+
+    //Every deque exists before the first worker may try to steal from it
+    for (int i = 0; i < threads; i++) {
+        m_workers.emplace_back(new Worker);
+        m_workers.back()->ring.resize((size_t)bands * streams);
+    }
+    for (int i = 0; i < threads; i++) {
+        m_workers[i]->thread = std::thread(&FrameScheduler::worker_loop, this, i);
+        if (!cpus.empty()) {
+            pin_thread(m_workers[i]->thread.native_handle(), cpus[i % cpus.size()]);
+        }
+    }
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    wait_idle();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::unique_ptr<Worker> &worker : m_workers) {
+        worker->thread.join();
+    }
+    if (m_event_fd >= 0) {
+        close(m_event_fd);
+    }
+}
+
+void FrameScheduler::pin_thread(pthread_t thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Failed to pin thread to CPU %d\n", cpu);
+    }
+}
+
+void FrameScheduler::set_stats_interval(int interval)
+{
+    m_stats_interval = interval;
+}
+
+bool FrameScheduler::busy(int stream) const
+{
+    return m_jobs[stream].busy.load(std::memory_order_acquire);
+}
+
+void FrameScheduler::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] {
+        for (int i = 0; i < m_streams; i++) {
+            if (busy(i)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+void FrameScheduler::submit(int stream, const rows_fn *passes, int count, int rows, const done_fn &done)
+{
+    Job *job = &m_jobs[stream];
+
+    for (int i = 0; i < count; i++) {
+        job->passes[i] = passes[i];
+    }
+    job->count = count;
+    job->pass = 0;
+    job->rows = rows;
+    job->done = done;
+    job->submit_ns = now_ns();
+    job->pending.store(m_bands, std::memory_order_relaxed);
+    job->busy.store(true, std::memory_order_relaxed);
+
+    //Each stream starts on its own worker, the others steal from there
+    push(stream % threads(), Task{job, 0, m_bands});
+}
+
+void FrameScheduler::push(int index, const Task &task)
+{
+    Worker *worker = m_workers[index].get();
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->ring[worker->bottom++ % worker->ring.size()] = task;
+    }
+
+    //Pairs with the sleeper incrementing m_sleeping before it checks m_queued
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_wake.notify_one();
+    }
+}
+
+bool FrameScheduler::pop(int index, Task &task)
+{
+    Worker *worker = m_workers[index].get();
+    std::lock_guard<std::mutex> lock(worker->mutex);
+
+    if (worker->bottom == worker->top) {
+        return false;
+    }
+    task = worker->ring[--worker->bottom % worker->ring.size()];
+    m_queued.fetch_sub(1);
+    return true;
+}
+
+bool FrameScheduler::steal(int index, Task &task)
+{
+    int count = threads();
+
+    for (int i = 1; i < count; i++) {
+        Worker *victim = m_workers[(index + i) % count].get();
+        std::lock_guard<std::mutex> lock(victim->mutex);
+
+        if (victim->bottom != victim->top) {
+            task = victim->ring[victim->top++ % victim->ring.size()];
+            m_queued.fetch_sub(1);
+            m_workers[index]->stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameScheduler::worker_loop(int index)
+{
+    Task task;
+
+    for (;;) {
+        if (pop(index, task) || steal(index, task)) {
+            execute(index, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+        m_sleeping.fetch_sub(1);
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+void FrameScheduler::execute(int index, Task task)
+{
+    Job *job = task.job;
+
+    //Keep the first band, the upper halves are left to this worker or to thieves
+    while (task.end - task.begin > 1) {
+        int middle = (task.begin + task.end) / 2;
+        push(index, Task{job, middle, task.end});
+        task.end = middle;
+    }
+
+    int begin = (int)((long long)job->rows * task.begin / m_bands);
+    int end = (int)((long long)job->rows * (task.begin + 1) / m_bands);
+    job->passes[job->pass](begin, end);
+    m_workers[index]->bands.fetch_add(1, std::memory_order_relaxed);
+
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finish_pass(index, job);
+    }
+}
+
+void FrameScheduler::finish_pass(int index, Job *job)
+{
+    //Next pass, every band of this one is complete
+    if (++job->pass < job->count) {
+        job->pending.store(m_bands, std::memory_order_relaxed);
+        push(index, Task{job, 0, m_bands});
+        return;
+    }
+
+    if (job->done) {
+        job->done();
+    }
+
+    bool report;
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        long long elapsed = now_ns() - job->submit_ns;
+        job->jobs++;
+        job->total_ns += elapsed;
+        job->max_ns = elapsed > job->max_ns ? elapsed : job->max_ns;
+        report = m_stats_interval > 0 && ++m_stats_jobs % m_stats_interval == 0;
+    }
+    if (report) {
+        print_stats();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->busy.store(false, std::memory_order_release);
+    }
+    m_idle.notify_all();
+
+    uint64_t one = 1;
+    if (m_event_fd >= 0 && write(m_event_fd, &one, sizeof(one)) < 0) {
+        perror("eventfd write");
+    }
+}
+
+void FrameScheduler::print_stats()
+{
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    double sum = 0, sum_squares = 0;
+
+    printf("Scheduler over %d jobs: bands (stolen) per worker", m_stats_interval);
+    for (std::unique_ptr<Worker> &worker : m_workers) {
+        printf(" %lu (%lu)", worker->bands.exchange(0), worker->stolen.exchange(0));
+    }
+    printf(", jobs mean/max ms per camera");
+    for (int i = 0; i < m_streams; i++) {
+        Job *job = &m_jobs[i];
+        printf(" %lu %.1f/%.1f", job->jobs, job->jobs ? job->total_ns / 1e6 / job->jobs : 0.0, job->max_ns / 1e6);
+        sum += job->jobs;
+        sum_squares += (double)job->jobs * job->jobs;
+        job->jobs = 0;
+        job->total_ns = 0;
+        job->max_ns = 0;
+    }
+    //Jain's index of the frames each camera got through: 1 is a fair share,
+    //1/cameras means a single camera got everything
+    printf(", fairness %.2f\n", sum_squares > 0 ? sum * sum / (m_streams * sum_squares) : 1.0);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Work stealing pool running the frame jobs of several cameras at once.
+//A job is a chain of passes (conversion, rotation, packing), each split into
+//horizontal bands. The last band of a pass starts the next one and the last
+//band of the job runs its done() callback (the Wayland commit), so the caller
+//only submits jobs and never waits on them.
+//Each job starts as a single range of bands on its camera's home worker. A
+//worker splits the range it takes in halves, keeps one band and leaves the
+//rest on its own deque, newest first; idle workers steal the oldest (largest)
+//ranges of the others. The bands of a camera stay on one core while the
+//other cameras keep theirs busy, and spread as soon as a core runs dry.
+class FrameScheduler {
+public:
+    typedef std::function<void(int, int)> rows_fn;    //(row_begin, row_end)
+    typedef std::function<void()> done_fn;
+
+    //Passes of one job at most
+    static const int MAX_PASSES = 4;
+
+    //threads: worker threads, the caller does not work on bands. streams:
+    //jobs in flight at once, one per camera. cpus: optional affinity list
+    FrameScheduler(int threads, int bands, int streams, const std::vector<int> &cpus);
+    ~FrameScheduler();
+
+    //Start a job of 'count' passes over 'rows' rows for 'stream', which must
+    //not be busy. Returns immediately.
+    void submit(int stream, const rows_fn *passes, int count, int rows, const done_fn &done);
+
+    //True until the last job of 'stream' has returned from done()
+    bool busy(int stream) const;
+
+    //Block until every job has completed
+    void wait_idle();
+
+    //eventfd signalled after each job, lets an event loop pick up frames that
+    //arrived while their camera was busy
+    int completion_fd() const { return m_event_fd; }
+
+    //Print per worker and per stream statistics every 'interval' jobs (0 disables)
+    void set_stats_interval(int interval);
+
+    int threads() const { return (int)m_workers.size(); }
+    int bands() const { return m_bands; }
+
+private:
+    struct Job {
+        rows_fn passes[MAX_PASSES];
+        int count = 0;
+        int pass = 0;                   //Pass being run
+        int rows = 0;
+        done_fn done;
+        std::atomic<int> pending{0};    //Bands of the current pass not finished
+        std::atomic<bool> busy{false};
+        long long submit_ns = 0;
+
+        //Submit to done() return time, since the last report
+        unsigned long jobs = 0;
+        long long total_ns = 0;
+        long long max_ns = 0;
+    };
+
+    //Bands [begin, end) of the current pass of 'job'
+    struct Task {
+        Job *job;
+        int begin;
+        int end;
+    };
+
+    //Deque of a worker: the owner pushes and pops at the bottom, thieves take
+    //the top. The ring holds every band of every stream, so it never grows.
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::vector<Task> ring;
+        size_t top = 0;
+        size_t bottom = 0;
+
+        std::atomic<unsigned long> bands{0};    //Bands run since the last report
+        std::atomic<unsigned long> stolen{0};   //Ranges taken from another worker
+    };
+
+    void worker_loop(int index);
+    void push(int index, const Task &task);
+    bool pop(int index, Task &task);
+    bool steal(int index, Task &task);
+    void execute(int index, Task task);
+    void finish_pass(int index, Job *job);
+    void print_stats();
+    static void pin_thread(pthread_t thread, int cpu);
+
+    int m_bands;
+    int m_streams;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::unique_ptr<Job[]> m_jobs;
+    int m_event_fd;
+
+    //Sleeping workers are woken when tasks are queued
+    std::atomic<int> m_queued;
+    std::atomic<int> m_sleeping;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    bool m_stop;
+
+    std::mutex m_stats_mutex;
+    int m_stats_interval;
+    unsigned long m_stats_jobs;
+};
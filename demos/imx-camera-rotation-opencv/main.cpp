@@ -20,7 +20,25 @@
 #include "xdg-shell-client-protocol.h"
 #include <mqueue.h>
 #include <sys/stat.h>
-#include <pthread.h>
+#include <getopt.h>
+#include "rotate_kernels.hpp"
+#include "rotation_plan.hpp"
+#include "band_pool.hpp"
+#include "frame_scheduler.hpp"
+#include "alloc_counter.hpp"
+#include "shear_rotate.hpp"
+#include "benchmark.hpp"
+#include "yuv_rotate.hpp"
+#include "output_format.h"
+#include "output_buffers.h"
+#include "v4l2_capture.h"
+#include "event_loop.h"
+#include "latency.h"
+#include "frame_pacer.h"
+#include "presentation-time-client-protocol.h"
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "viewporter-client-protocol.h"
+#include "surface_transform.h"
 
 using namespace cv;
 using namespace std;
@@ -40,8 +58,73 @@ using namespace std;
 static int width = IMAGE_WIDTH;
 static int height = IMAGE_HEIGHT;
 
-//Global variable for angle capture
-int angle_deg;
+//Cameras handled by the process: the positional device, then --camera
+#define MAX_CAMERAS 4
+static int camera_count = 1;
+
+//Rotation engine used by Convert_Rotate()
+static enum rotate_engine engine = ENGINE_OPENCV;
+static bool engine_set = false;
+
+//Interpolation, -1 until resolved against the engine after parsing
+static int quality = -1;
+
+//Camera pixel format (--input-format), updated with the format the driver
+//actually delivers. Formats other than YUYV need the fused engine.
+static enum rotate_src_format input_format = SRC_YUYV;
+//Format written by the fused kernels: RGB565 outputs are written directly,
+//every other engine produces BGRA
+static enum rotate_dst_format kernel_dst = DST_BGRA;
+
+//Precomputed per (width, height, angle) rotation maps
+#define PLAN_CACHE_MB_DEFAULT 64
+static size_t plan_cache_mb = PLAN_CACHE_MB_DEFAULT;
+static RotationPlanCache *plan_cache;
+
+//Band parallel execution of the rotation engines (0 threads = all online CPUs)
+#define BANDS_PER_THREAD 4
+static int pool_threads = 0;
+static int pool_bands = 0;
+static int band_stats_interval = 0;
+static std::vector<int> pool_cpus;
+static BandPool *band_pool;
+//With several cameras, their frame jobs share the threads of a work stealing
+//scheduler instead
+static FrameScheduler *scheduler;
+
+//Wayland output format (--format), resolved against the wl_shm formats
+static enum output_format output_format = OUTPUT_FORMAT_AUTO;
+static struct output_formats shm_formats;
+//Output buffers the frames of each camera rotate through and their memory
+//(--output-buffers, --output-memory): dma-heap buffers imported by the
+//compositor through linux-dmabuf, or wl_shm buffers it copies from
+static unsigned int output_buffer_count = OUTPUT_BUFFERS_DEFAULT;
+static enum output_memory output_memory = OUTPUT_MEMORY_AUTO;
+static struct output_formats dmabuf_formats;
+
+//V4L2 capture buffers and frame rate (--buffers, --capture-memory, --inflight, --latest, --fps)
+static unsigned int capture_buffers = CAPTURE_BUFFERS_DEFAULT;
+static enum capture_memory capture_memory = CAPTURE_MMAP;
+static unsigned int capture_inflight = CAPTURE_INFLIGHT_DEFAULT;
+static bool capture_latest = false;
+static double capture_fps = 0;
+static int capture_stats_interval = 0;
+
+//Presentation pacing (--pacing): render on wl_surface.frame callbacks or on
+//every camera frame
+static bool frame_pacing = true;
+
+//Right angle rotations done by the compositor, the engines only rotate the
+//residual angle (--compositor-rotation)
+static bool compositor_rotation = false;
+
+//Glass to glass latency report period and CSV log (--latency, --latency-log)
+static int latency_interval = 0;
+static const char *latency_log = NULL;
+static struct latency latency;
+
+//Allocation counter report period (make ALLOC_COUNTER=1)
+#define ALLOC_REPORT_FRAMES 300
 
 //Wayland globals
 struct wl_display *display;
@@ -50,6 +133,9 @@ struct wl_shm *shm;
 struct xdg_wm_base *xdg_wm_base_1;
 struct wl_seat *seat;
 struct wl_pointer *pointer;
+struct wp_presentation *presentation;
+struct zwp_linux_dmabuf_v1 *dmabuf;
+struct wp_viewporter *viewporter;
 static struct xdg_toplevel *current_toplevel = NULL;
  
 //Registry listener to bind Wayland interfaces
@@ -58,10 +144,19 @@ static void registry_global(void *data, struct wl_registry *registry, uint32_t n
         compositor = (struct wl_compositor *) wl_registry_bind(registry, name, &wl_compositor_interface, 4);
     } else if (strcmp(interface, wl_shm_interface.name) == 0) {
         shm = (struct wl_shm *) wl_registry_bind(registry, name, &wl_shm_interface, 1);
+        output_formats_listen(shm, &shm_formats);
     } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
         xdg_wm_base_1 = (struct xdg_wm_base *) wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
     } else if (strcmp(interface, wl_seat_interface.name) == 0) {
         seat = (struct wl_seat *) wl_registry_bind(registry, name, &wl_seat_interface, 1);
+    } else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+        presentation = (struct wp_presentation *) wl_registry_bind(registry, name, &wp_presentation_interface, 1);
+        latency_set_presentation(&latency, presentation);
+    } else if (strcmp(interface, zwp_linux_dmabuf_v1_interface.name) == 0 && version >= 3) {
+        dmabuf = (struct zwp_linux_dmabuf_v1 *) wl_registry_bind(registry, name, &zwp_linux_dmabuf_v1_interface, 3);
+        output_formats_listen_dmabuf(dmabuf, &dmabuf_formats);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        viewporter = (struct wp_viewporter *) wl_registry_bind(registry, name, &wp_viewporter_interface, 1);
     }
 }
  
@@ -99,7 +194,10 @@ static const struct xdg_toplevel_listener xdg_toplevel_listener = {
 
 //Pointer event handlers
 static void pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface, wl_fixed_t sx, wl_fixed_t sy) {
-    //Pointer entered the surface
+    //Pointer entered a camera window, a click moves it. Each surface carries its toplevel.
+    if (surface) {
+        current_toplevel = (struct xdg_toplevel *) wl_surface_get_user_data(surface);
+    }
 }
 
 static void pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface) {
@@ -148,100 +246,886 @@ static const struct wl_seat_listener seat_listener = {
     .name = seat_name,
 };
  
-//Buffer release listener
-static void buffer_release(void *data, struct wl_buffer *buffer) {
-    //Buffer is free to reuse
-}
- 
-static const struct wl_buffer_listener buffer_listener = {
-    .release = buffer_release,
+//Persistent state of Convert_Rotate(), one per camera. Every Mat is allocated
+//once, the frame loop only rewraps headers around the capture and output
+//buffers, so the steady state does not touch the heap and the result is
+//written in place.
+struct convert_rotate_ctx {
+    Mat yuvImage;               //Header over the current capture buffer
+    Mat rgbaImage;              //Converted frame (OpenCV engine)
+    Mat output;                 //Header over the output (wl_shm or dma-buf) buffer
+    Mat scratch;                //Output used when no buffer is given
+    Mat shear1;                 //Intermediate images of the shear engine
+    Mat shear2;
+    Scalar background;          //Black background (B, G, R, A)
+    struct fused_frame frame;
+    rotate_rows_fn rows;        //Fused kernel of the formats and quality
+    struct shear_frame shear;
+    struct yuv_frame yuv;       //Planes of the YUV engine
+    int quarters;               //Clockwise quarter turns of the exact kernels
+    rotation_plan_ptr plan;
+    bool fill_bg;               //Background outside the spans must be written
+    rotation_plan_ptr bg_previous;  //Plan of the last frame of the output buffer, nullptr = fill it all
+    struct output_rect content;     //Pixels the frame changes, the rest stays background
+    bool content_full;
+    //Plan whose background each output buffer already holds
+    struct {
+        uint8_t *dst;
+        rotation_plan_ptr plan;
+    } bg[OUTPUT_BUFFERS_MAX];
+    uint8_t *packed;            //RGB565/NV12 output buffer of Pack_Output()
 };
 
-void Convert_Rotate(unsigned char* yuvBuffer, int w, int h, unsigned char* rgbaBuffer, int N_angle) {
-    Mat M, rotated;
-    Point2f center;
-    //Black background (B, G, R, A)
-    Scalar background_color(0, 0, 0, 0xff); 
-    //Adjust angle
-    N_angle = 360-(N_angle%360);
-
-    //Create a Mat from the YUV buffer
-    //YUYV is 2 bytes per pixel (Y0, U, Y1, V for two pixels), so use CV_8UC2
-    Mat yuvImage(h, w, CV_8UC2, (void*)yuvBuffer);
- 
-    //Convert YUV to RGBA
-    Mat rgbaImage;
-    cvtColor(yuvImage, rgbaImage, COLOR_YUV2BGRA_YUYV);
+//Band passes of one frame, each needs the previous one complete
+struct frame_job {
+    FrameScheduler::rows_fn passes[FrameScheduler::MAX_PASSES];
+    int count;
+};
 
-    //Rotate frame
-    center.x = w/2;
-    center.y = h/2;
-    M = getRotationMatrix2D(center, N_angle, 1.0);
-    warpAffine( rgbaImage, rotated, M, rgbaImage.size(), INTER_LINEAR, BORDER_CONSTANT, background_color);
+//A camera and its window. Each camera has its own angle, capture buffers,
+//conversion state and surface, the frames of all of them share the rotation
+//threads.
+struct camera_stream {
+    int index;
+    const char *device;
+    int angle;
+    struct capture cam;
+    struct convert_rotate_ctx ctx;
+    struct frame_job job;
+    //Newest frame received while the previous one was still processed
+    bool pending;
+    struct v4l2_buffer pending_buf;
+    //Frame being processed, its commit may run on a rotation thread
+    struct latency_frame *frame_latency;
+    unsigned long watchdog_frames;
 
-    //Copy the RGBA data to the output buffer
+    //Window, frames are written in place into a free output buffer
+    struct output_buffers outputs;
+    struct output_buffer *output;   //Buffer of the frame being processed
+    struct frame_pacer pacer;
+    struct surface_transform transform;
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+};
+static struct camera_stream cameras[MAX_CAMERAS];
+
+static void Convert_Rotate_Init(struct convert_rotate_ctx *ctx, int w, int h) {
+    ctx->rgbaImage.create(h, w, CV_8UC4);
+    ctx->scratch.create(h, w, CV_8UC4);
+    if (engine == ENGINE_SHEAR) {
+        ctx->shear1.create(h, shear_max_width(w, h), CV_8UC4);
+        ctx->shear2.create(h, shear_max_width(w, h), CV_8UC4);
+    }
+    if (engine == ENGINE_YUV) {
+        yuv_frame_create(&ctx->yuv, w, h);
+    }
+    ctx->background = Scalar(0, 0, 0, 0xff);
+    ctx->rows = rotate_kernel_select(input_format, kernel_dst, (enum rotate_quality)quality);
+}
+
+//Black the pixels the last frame of the output buffer wrote and this one does
+//not, everything else around the spans is background already
+static void fill_background(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    if (ctx->fill_bg) {
+        rotate_fill_uncovered(&ctx->frame, ctx->bg_previous ? ctx->bg_previous->spans.data() : nullptr, row_begin,
+                              row_end);
+    }
+}
+
+//Band jobs, bound to their camera by add_pass()
+static void fused_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    fill_background(ctx, row_begin, row_end);
+    ctx->rows(&ctx->frame, row_begin, row_end);
+}
+
+static void right_angle_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    right_angle_rotate_rows(&ctx->frame, ctx->quarters, row_begin, row_end);
+}
+
+static void shear1_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    shear_pass1_rows(&ctx->shear, row_begin, row_end);
+}
+
+static void shear2_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    shear_pass2_rows(&ctx->shear, row_begin, row_end);
+}
+
+static void shear3_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    shear_pass3_rows(&ctx->shear, row_begin, row_end);
+}
+
+static void convert_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    Mat dst = ctx->rgbaImage.rowRange(row_begin, row_end);
+    cvtColor(ctx->yuvImage.rowRange(row_begin, row_end), dst, COLOR_YUV2BGRA_YUYV);
+}
+
+static void remap_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    fill_background(ctx, row_begin, row_end);
+    remap_spans(ctx->rgbaImage, ctx->output, ctx->plan->map1, ctx->plan->map2, ctx->frame.spans, row_begin, row_end,
+                quality == QUALITY_NEAREST, ctx->background);
+}
+
+static void yuv_rotate(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    yuv_rotate_rows(&ctx->yuv, row_begin, row_end);
+}
+
+static void yuv_convert(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    fill_background(ctx, row_begin, row_end);
+    yuv_convert_rows(&ctx->yuv, row_begin, row_end);
+}
+
+//Append a band pass. The lambda holds two pointers, which std::function
+//stores inline, so building a frame never allocates.
+static void add_pass(struct frame_job *job, void (*rows)(struct convert_rotate_ctx *, int, int),
+                     struct convert_rotate_ctx *ctx) {
+    job->passes[job->count++] = [rows, ctx](int row_begin, int row_end) { rows(ctx, row_begin, row_end); };
+}
+
+//Background plan slot of an output buffer. The buffers of a camera take the
+//slots in turn, a new buffer evicts the first slot.
+static rotation_plan_ptr &background_plan(struct convert_rotate_ctx *ctx, uint8_t *dst) {
+    for (auto &bg : ctx->bg) {
+        if (bg.dst == dst || bg.dst == nullptr) {
+            bg.dst = dst;
+            return bg.plan;
+        }
+    }
+    ctx->bg[0].dst = dst;
+    ctx->bg[0].plan = nullptr;
+    return ctx->bg[0].plan;
+}
+
+//Prepare the conversion and rotation of a frame into rgbaBuffer and append its
+//passes to 'job'. The input is in input_format, the output BGRA or RGB565 for
+//the fused engine (kernel_dst). Multiples of 90 degrees of YUYV to BGRA take
+//the exact (lossless) kernels. The previous frame of 'ctx' must be complete.
+static void Convert_Rotate(struct convert_rotate_ctx *ctx, unsigned char* yuvBuffer, int w, int h,
+                           unsigned char* rgbaBuffer, int N_angle, struct frame_job *job) {
+    alloc_scope scope;
+    bool right_angle_kernels = input_format == SRC_YUYV && kernel_dst == DST_BGRA;
+    ctx->quarters = right_angle_kernels ? right_angle_quarters(N_angle) : -1;
+
+    //Rotation maps come from the plan cache, no trigonometry per frame
+    if (ctx->quarters < 0) {
+        ctx->plan = plan_cache->get(w, h, N_angle, ctx->plan);
+    }
+
+    //Wrap the input and output buffers, YUYV is 2 bytes per pixel so use CV_8UC2
+    int bpp = kernel_dst == DST_RGB565 ? 2 : 4;
+    ctx->yuvImage = Mat(h, w, CV_8UC2, (void*)yuvBuffer);
     if (rgbaBuffer != nullptr) {
-        memcpy(rgbaBuffer, rotated.data, w * h * 4);
+        ctx->output = Mat(h, w, CV_8UC(bpp), (void*)rgbaBuffer);
+    } else {
+        ctx->output = ctx->scratch;
+    }
+
+    ctx->frame.src = yuvBuffer;
+    ctx->frame.src_width = w;
+    ctx->frame.src_height = h;
+    ctx->frame.src_stride = rotate_src_stride(input_format, w);
+    ctx->frame.src_format = input_format;
+    ctx->frame.src_uv = yuvBuffer + (size_t)ctx->frame.src_stride * h;
+    ctx->frame.dst = ctx->output.data;
+    ctx->frame.dst_width = w;
+    ctx->frame.dst_height = h;
+    ctx->frame.dst_stride = w * bpp;
+    ctx->frame.dst_format = kernel_dst;
+    ctx->frame.spans = nullptr;
+
+    //Only the rotated footprint is resampled. The background around it is
+    //still black when the last frame written to this buffer used the same
+    //plan, otherwise only what that frame covered is refilled.
+    rotation_plan_ptr &bg_plan = background_plan(ctx, ctx->frame.dst);
+    if (ctx->quarters < 0 && engine != ENGINE_SHEAR) {
+        const Rect &footprint = ctx->plan->footprint;
+        ctx->frame.spans = ctx->plan->spans.data();
+        ctx->fill_bg = bg_plan != ctx->plan;
+        ctx->bg_previous = bg_plan;
+        bg_plan = ctx->plan;
+        ctx->content = {footprint.x, footprint.y, footprint.width, footprint.height};
+        ctx->content_full = false;
+    } else {
+        //These paths rewrite every pixel
+        bg_plan = nullptr;
+        ctx->content_full = true;
+    }
+
+    if (ctx->quarters >= 0) {
+        //Straight conversion, reversed rows or tiled transpose, no interpolation
+        add_pass(job, right_angle_rows, ctx);
+    } else if (engine == ENGINE_FUSED) {
+        //Single pass conversion + rotation straight into the output buffer
+        ctx->frame.map = ctx->plan->map;
+        add_pass(job, fused_rows, ctx);
+    } else if (engine == ENGINE_SHEAR) {
+        //Three 1D shifts through the intermediate images
+        ctx->shear.src = yuvBuffer;
+        ctx->shear.width = w;
+        ctx->shear.height = h;
+        ctx->shear.src_stride = w * 2;
+        ctx->shear.tmp1 = ctx->shear1.data;
+        ctx->shear.tmp2 = ctx->shear2.data;
+        ctx->shear.tmp_stride = (int)ctx->shear1.step;
+        ctx->shear.dst = ctx->output.data;
+        ctx->shear.dst_stride = w * 4;
+        ctx->shear.plan = &ctx->plan->shear;
+        add_pass(job, shear1_rows, ctx);
+        add_pass(job, shear2_rows, ctx);
+        add_pass(job, shear3_rows, ctx);
+    } else if (engine == ENGINE_YUV) {
+        //Rotate the YUYV frame into luma and chroma planes, then convert only the visible pixels
+        ctx->yuv.src = ctx->yuvImage;
+        ctx->yuv.dst = ctx->output;
+        ctx->yuv.plan = ctx->plan.get();
+        ctx->yuv.quality = (enum rotate_quality)quality;
+        add_pass(job, yuv_rotate, ctx);
+        add_pass(job, yuv_convert, ctx);
+    } else {
+        //Convert YUV to RGBA, then rotate (gather through the precomputed
+        //fixed point maps) directly into the output buffer
+        add_pass(job, convert_rows, ctx);
+        add_pass(job, remap_rows, ctx);
     }
 }
 
+//RGB565/NV12 outputs: pack the BGRA frame Convert_Rotate() left in ctx->scratch
+static void pack_rows(struct convert_rotate_ctx *ctx, int row_begin, int row_end) {
+    alloc_scope scope;
+    int w = ctx->scratch.cols;
+    int h = ctx->scratch.rows;
+    int stride = output_format_stride(output_format, w);
 
-//Structure to pass data to the receiver thread (if needed)
-typedef struct {
-    mqd_t mq;
-} receiver_data_t;
- 
-//Receiver thread function
-void *receiver_thread(void *arg) {
-    receiver_data_t *data = (receiver_data_t *)arg;
-    mqd_t mq = data->mq;
-    char buffer[MAX_SIZE];
-    ssize_t bytes_read;
- 
-    printf("Receiver thread: Waiting for messages...\n");
- 
-    while (1) {
-        //Receive message from queue
-        bytes_read = mq_receive(mq, buffer, MAX_SIZE, NULL);
-        if (bytes_read == -1) {
-            perror("mq_receive");
-            break;
+    if (output_format == OUTPUT_RGB565) {
+        for (int y = row_begin; y < row_end; y++) {
+            bgra_to_rgb565_row(ctx->scratch.ptr(y), w, ctx->packed + (size_t)y * stride);
         }
- 
+    } else {
+        bgra_to_nv12_rows(ctx->scratch.data, (int)ctx->scratch.step, w, h, ctx->packed, ctx->packed + (size_t)stride * h,
+                          stride, row_begin, row_end);
+    }
+}
+
+static void Pack_Output(struct convert_rotate_ctx *ctx, unsigned char *buffer, struct frame_job *job) {
+    ctx->packed = buffer;
+    add_pass(job, pack_rows, ctx);
+}
+
+//Run the passes of a frame of 'camera', then present() it. The scheduler
+//returns at once, the band pool once the last pass has started; present()
+//then runs on whichever thread finishes the last band.
+static void Run_Frame(struct camera_stream *camera, const struct frame_job *job, int h,
+                      const std::function<void()> &present) {
+    if (scheduler) {
+        scheduler->submit(camera->index, job->passes, job->count, h, present);
+        return;
+    }
+    if (band_pool) {
+        for (int i = 0; i < job->count - 1; i++) {
+            band_pool->run(h, job->passes[i], nullptr);
+            band_pool->wait_idle();
+        }
+        band_pool->run(h, job->passes[job->count - 1], present);
+        return;
+    }
+    for (int i = 0; i < job->count; i++) {
+        job->passes[i](0, h);
+    }
+    present();
+}
+
+//Hand the finished frame to the compositor
+static void commit_frame(struct camera_stream *camera) {
+    output_buffers_attach(&camera->outputs, camera->output, camera->surface,
+                          camera->ctx.content_full ? nullptr : &camera->ctx.content);
+    latency_commit(camera->frame_latency, camera->surface);
+    frame_pacer_commit(&camera->pacer, camera->surface);
+    wl_surface_commit(camera->surface);
+    wl_display_flush(display);
+}
+
+
+//Event loop sources
+enum {
+    SOURCE_MESSAGES = 0,
+    SOURCE_WATCHDOG,
+    SOURCE_JOBS,            //Frame jobs completed by the scheduler
+    SOURCE_CAMERA,          //First camera, camera i is SOURCE_CAMERA + i
+};
+static_assert(SOURCE_CAMERA + MAX_CAMERAS <= EVENT_LOOP_MAX_SOURCES, "Too many event sources");
+//Period of the camera watchdog, reports when no frame arrived in between
+#define WATCHDOG_MS 1000
+
+//Angle the engines rotate a camera frame by: the whole angle, or with
+//--compositor-rotation what is left after the quarter turns the compositor
+//applies (returned in 'quarters')
+static int backend_angle(const struct camera_stream *camera, int *quarters) {
+    int residual = camera->angle;
+    int turns = compositor_rotation ? surface_transform_split(camera->angle, &residual) : 0;
+    if (quarters) {
+        *quarters = turns;
+    }
+    return residual;
+}
+
+//Read every pending angle message, returns 1 once the exit message arrived
+//and -1 if the queue failed. "<angle>" rotates the first camera,
+//"<camera>:<angle>" the given one.
+static int read_angle_messages(mqd_t mq) {
+    char buffer[MAX_SIZE + 1];
+    ssize_t bytes_read;
+
+    while ((bytes_read = mq_receive(mq, buffer, MAX_SIZE, NULL)) >= 0) {
         buffer[bytes_read] = '\0'; // Null-terminate the string
-        angle_deg = atoi(buffer);
-        printf("Received angle: %i\n", angle_deg);
- 
+
         //Check if exit message is received
         if (strcmp(buffer, MSG_STOP) == 0) {
+            return 1;
+        }
+        int index = 0;
+        char *angle = strchr(buffer, ':');
+        if (angle) {
+            index = atoi(buffer);
+            angle++;
+        } else {
+            angle = buffer;
+        }
+        if (index < 0 || index >= camera_count) {
+            fprintf(stderr, "Angle for unknown camera %d\n", index);
+            continue;
+        }
+        cameras[index].angle = atoi(angle);
+        printf("Received angle: %i (camera %d)\n", cameras[index].angle, index);
+
+        //Build the rotation maps for the new angle off the frame loop
+        int rotate_angle = backend_angle(&cameras[index], nullptr);
+        if (right_angle_quarters(rotate_angle) < 0) {
+            plan_cache->prefetch(width, height, rotate_angle);
+        }
+    }
+    if (errno != EAGAIN) {
+        perror("mq_receive");
+        return -1;
+    }
+    return 0;
+}
+
+
+
+static void print_usage(void) {
+    printf("Ussage: ./app, v4l2 device, width, height, angle [options]\n");
+    printf("       ./app --bench [frames]   Compare the CPU engines on synthetic frames\n");
+    printf("Options:\n");
+    printf("  --engine=opencv|fused|shear|yuv  CPU rotation engine (default: opencv)\n");
+    printf("  --quality=nearest|q8|q16|float   Interpolation (default: float with opencv, q8 otherwise)\n");
+    printf("                                   opencv: nearest|float, fused, yuv: nearest|q8|q16, shear: nearest|q8\n");
+    printf("  --format=auto|argb8888|xrgb8888|rgb565|nv12\n");
+    printf("                                   Output pixel format (default: auto, xrgb8888 if available)\n");
+    printf("  --input-format=yuyv|uyvy|nv12|grey\n");
+    printf("                                   Camera pixel format (default: yuyv, others use the fused engine)\n");
+    printf("  --plan-cache-mb=N                Memory bound of the rotation plan cache (default: %d)\n", PLAN_CACHE_MB_DEFAULT);
+    printf("  --threads=N                      Threads used for rotation (default: online CPUs)\n");
+    printf("  --bands=N                        Horizontal bands per frame (default: %d per thread)\n", BANDS_PER_THREAD);
+    printf("  --affinity=CPU[,CPU..]           Pin rotation threads to these CPUs\n");
+    printf("  --band-stats=N                   Print per band timing (scheduler statistics with several\n");
+    printf("                                   cameras) every N frames\n");
+    printf("  --output-buffers=N               Wayland buffers the frames rotate through, 1 to %d (default: %d)\n",
+           OUTPUT_BUFFERS_MAX, OUTPUT_BUFFERS_DEFAULT);
+    printf("  --output-memory=auto|shm|dmabuf  Wayland buffer memory, dmabuf frames are read by the compositor\n");
+    printf("                                   without a copy (default: auto, dmabuf if available)\n");
+    printf("  --buffers=N                      Camera buffers (default: %d)\n", CAPTURE_BUFFERS_DEFAULT);
+    printf("  --capture-memory=mmap|userptr|dmabuf\n");
+    printf("                                   Camera buffer memory (default: mmap)\n");
+    printf("  --inflight=N                     Camera buffers held while processing (default: %d)\n", CAPTURE_INFLIGHT_DEFAULT);
+    printf("  --capture-stats=N                Print captured, dropped and torn frames every N frames\n");
+    printf("  --latest                         Display only the newest camera frame, requeue the stale ones\n");
+    printf("  --fps=N                          Camera frame rate set with VIDIOC_S_PARM (default: the driver's)\n");
+    printf("  --pacing=frame|capture           Render on frame callbacks (default) or on every camera frame\n");
+    printf("  --compositor-rotation            The compositor applies the nearest 90/180/270 degree turn (buffer\n");
+    printf("                                   transform + wp_viewporter), the engines only rotate the rest\n");
+    printf("  --latency=N                      Print capture to screen latency percentiles every N frames\n");
+    printf("  --latency-log=FILE               Write the latency of every frame to a CSV file\n");
+    printf("  --camera=DEV[@ANGLE]             Add a camera at the same resolution in its own window (up to %d)\n",
+           MAX_CAMERAS);
+}
+
+//--camera=DEV[@ANGLE], extra cameras start at the angle of the first one
+static int add_camera(char *arg) {
+    if (camera_count == MAX_CAMERAS) {
+        fprintf(stderr, "At most %d cameras are supported\n", MAX_CAMERAS);
+        return -1;
+    }
+    struct camera_stream *camera = &cameras[camera_count++];
+    char *angle = strrchr(arg, '@');
+
+    camera->angle = cameras[0].angle;
+    if (angle) {
+        *angle = '\0';
+        camera->angle = atoi(angle + 1);
+    }
+    camera->device = arg;
+    return 0;
+}
+
+//Parse the optional arguments following the positional ones
+static int parse_options(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"quality", required_argument, NULL, 'q'},
+        {"format", required_argument, NULL, 'f'},
+        {"input-format", required_argument, NULL, 'i'},
+        {"plan-cache-mb", required_argument, NULL, 'p'},
+        {"threads", required_argument, NULL, 't'},
+        {"bands", required_argument, NULL, 'b'},
+        {"affinity", required_argument, NULL, 'a'},
+        {"band-stats", required_argument, NULL, 's'},
+        {"output-buffers", required_argument, NULL, 'o'},
+        {"output-memory", required_argument, NULL, 'w'},
+        {"buffers", required_argument, NULL, 'n'},
+        {"capture-memory", required_argument, NULL, 'm'},
+        {"inflight", required_argument, NULL, 'r'},
+        {"capture-stats", required_argument, NULL, 'c'},
+        {"latest", no_argument, NULL, 'l'},
+        {"fps", required_argument, NULL, 'v'},
+        {"pacing", required_argument, NULL, 'u'},
+        {"compositor-rotation", no_argument, NULL, 'k'},
+        {"latency", required_argument, NULL, 'y'},
+        {"latency-log", required_argument, NULL, 'g'},
+        {"camera", required_argument, NULL, 'd'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    optind = 5;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'e':
+            if (strcmp(optarg, "opencv") == 0) {
+                engine = ENGINE_OPENCV;
+            } else if (strcmp(optarg, "fused") == 0) {
+                engine = ENGINE_FUSED;
+            } else if (strcmp(optarg, "shear") == 0) {
+                engine = ENGINE_SHEAR;
+            } else if (strcmp(optarg, "yuv") == 0) {
+                engine = ENGINE_YUV;
+            } else {
+                fprintf(stderr, "Unknown engine: %s\n", optarg);
+                return -1;
+            }
+            engine_set = true;
+            break;
+        case 'q':
+            if (strcmp(optarg, "nearest") == 0) {
+                quality = QUALITY_NEAREST;
+            } else if (strcmp(optarg, "q8") == 0) {
+                quality = QUALITY_Q8;
+            } else if (strcmp(optarg, "q16") == 0) {
+                quality = QUALITY_Q16;
+            } else if (strcmp(optarg, "float") == 0) {
+                quality = QUALITY_FLOAT;
+            } else {
+                fprintf(stderr, "Unknown quality: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'f':
+            if (output_format_parse(optarg, &output_format) < 0) {
+                fprintf(stderr, "Unknown output format: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'i':
+            if (strcmp(optarg, "yuyv") == 0) {
+                input_format = SRC_YUYV;
+            } else if (strcmp(optarg, "uyvy") == 0) {
+                input_format = SRC_UYVY;
+            } else if (strcmp(optarg, "nv12") == 0) {
+                input_format = SRC_NV12;
+            } else if (strcmp(optarg, "grey") == 0) {
+                input_format = SRC_GREY;
+            } else {
+                fprintf(stderr, "Unknown input format: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'p':
+            plan_cache_mb = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            pool_threads = atoi(optarg);
+            break;
+        case 'b':
+            pool_bands = atoi(optarg);
+            break;
+        case 'a':
+            for (char *cpu = strtok(optarg, ","); cpu; cpu = strtok(NULL, ",")) {
+                pool_cpus.push_back(atoi(cpu));
+            }
+            break;
+        case 's':
+            band_stats_interval = atoi(optarg);
+            break;
+        case 'o':
+            output_buffer_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            if (output_memory_parse(optarg, &output_memory) < 0) {
+                fprintf(stderr, "Unknown output memory: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'n':
+            capture_buffers = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (capture_memory_parse(optarg, &capture_memory) < 0) {
+                fprintf(stderr, "Unknown capture memory: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'r':
+            capture_inflight = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            capture_stats_interval = atoi(optarg);
+            break;
+        case 'l':
+            capture_latest = true;
+            break;
+        case 'v':
+            capture_fps = strtod(optarg, NULL);
             break;
+        case 'u':
+            if (strcmp(optarg, "frame") == 0) {
+                frame_pacing = true;
+            } else if (strcmp(optarg, "capture") == 0) {
+                frame_pacing = false;
+            } else {
+                fprintf(stderr, "Unknown pacing: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'k':
+            compositor_rotation = true;
+            break;
+        case 'y':
+            latency_interval = atoi(optarg);
+            break;
+        case 'g':
+            latency_log = optarg;
+            break;
+        case 'd':
+            if (add_camera(optarg) < 0) {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
         }
     }
-    printf("Receiver thread: Done\n");
-    pthread_exit(NULL);
+
+    //A quality alone picks the engine: float is OpenCV, the others the fixed point kernels.
+    //Only the fused kernels read other formats than YUYV.
+    if (!engine_set && input_format != SRC_YUYV) {
+        engine = ENGINE_FUSED;
+    } else if (!engine_set && quality >= 0) {
+        engine = quality == QUALITY_FLOAT ? ENGINE_OPENCV : ENGINE_FUSED;
+    }
+    if (quality < 0) {
+        quality = engine == ENGINE_OPENCV ? QUALITY_FLOAT : QUALITY_Q8;
+    }
+    //cv::remap interpolates in float or takes the nearest pixel, the shear
+    //passes only have Q8 weights, the fused and yuv kernels everything but float
+    static const char *const engine_qualities[][2] = {
+        {"opencv", "nearest|float"},    //ENGINE_OPENCV
+        {"fused", "nearest|q8|q16"},    //ENGINE_FUSED
+        {"shear", "nearest|q8"},        //ENGINE_SHEAR
+        {"yuv", "nearest|q8|q16"},      //ENGINE_YUV
+    };
+    bool supported = quality == QUALITY_NEAREST ||
+                     (quality == QUALITY_FLOAT ? engine == ENGINE_OPENCV
+                                               : engine == ENGINE_FUSED || engine == ENGINE_YUV ||
+                                                     (engine == ENGINE_SHEAR && quality == QUALITY_Q8));
+    if (!supported) {
+        fprintf(stderr, "The %s engine only supports --quality=%s\n", engine_qualities[engine][0],
+                engine_qualities[engine][1]);
+        return -1;
+    }
+    if (input_format != SRC_YUYV && engine != ENGINE_FUSED) {
+        fprintf(stderr, "Input format %s is only available with the fused engine\n", rotate_src_format_name(input_format));
+        return -1;
+    }
+    return 0;
+}
+
+//Open a camera with the capture options. The driver may substitute another
+//format: the kernels follow the first camera's if they can, the other
+//cameras must deliver the same.
+static int open_camera(struct camera_stream *camera) {
+    struct capture_config cam_config = {};
+    cam_config.device = camera->device;
+    cam_config.width = width;
+    cam_config.height = height;
+    cam_config.fourcc = rotate_src_format_fourcc(input_format);
+    cam_config.buffers = capture_buffers;
+    cam_config.memory = capture_memory;
+    cam_config.inflight = capture_inflight;
+    cam_config.nonblocking = true;
+    cam_config.latest = capture_latest;
+    cam_config.fps = capture_fps;
+    //A camera busy on the scheduler holds its frame in progress and the
+    //newest frame waiting for it
+    if (scheduler && cam_config.inflight < 2) {
+        cam_config.inflight = 2;
+    }
+    if (capture_open(&camera->cam, &cam_config) < 0) {
+        return -1;
+    }
+
+    uint32_t fourcc = camera->cam.format.fmt.pix.pixelformat;
+    if (camera->index > 0 && fourcc != cameras[0].cam.format.fmt.pix.pixelformat) {
+        fprintf(stderr, "Camera %s does not deliver the format of %s\n", camera->device, cameras[0].device);
+        return -1;
+    }
+    if (rotate_src_format_from_fourcc(fourcc, &input_format) < 0 ||
+        (input_format != SRC_YUYV && engine != ENGINE_FUSED)) {
+        fprintf(stderr, "Camera format %c%c%c%c is not supported by the %s engine\n", fourcc & 0xff,
+                (fourcc >> 8) & 0xff, (fourcc >> 16) & 0xff, fourcc >> 24, engine == ENGINE_FUSED ? "fused" : "selected");
+        return -1;
+    }
+    printf("%s: input format %s, %u %s buffers\n", camera->device, rotate_src_format_name(input_format),
+           camera->cam.count, capture_memory_name(camera->cam.memory));
+    return 0;
 }
 
+//Create the output buffers and the xdg toplevel of a camera. dma-bufs fall
+//back to wl_shm buffers unless they were forced.
+static int create_window(struct camera_stream *camera) {
+    if (output_memory != OUTPUT_SHM &&
+        output_buffers_create_dmabuf(&camera->outputs, display, dmabuf, output_buffer_count, output_format, width,
+                                     height, NULL, NULL) < 0) {
+        if (output_memory == OUTPUT_DMABUF) {
+            return -1;
+        }
+        fprintf(stderr, "%s: falling back to wl_shm output buffers\n", camera->device);
+    }
+    if (camera->outputs.count == 0 &&
+        output_buffers_create(&camera->outputs, shm, output_buffer_count, output_format, width, height) < 0) {
+        return -1;
+    }
+    printf("%s: output memory %s, %u buffers\n", camera->device, output_memory_name(camera->outputs.memory),
+           camera->outputs.count);
+    frame_pacer_init(&camera->pacer, frame_pacing);
+
+    //Create Wayland surface and xdg toplevel, titled after the device when
+    //there are several cameras
+    char title[64];
+    camera->surface = wl_compositor_create_surface(compositor);
+    surface_transform_init(&camera->transform, compositor_rotation, viewporter, camera->surface, width, height);
+    camera->xdg_surface = xdg_wm_base_get_xdg_surface(xdg_wm_base_1, camera->surface);
+    xdg_surface_add_listener(camera->xdg_surface, &xdg_surface_listener, NULL);
+    camera->xdg_toplevel = xdg_surface_get_toplevel(camera->xdg_surface);
+    xdg_toplevel_add_listener(camera->xdg_toplevel, &xdg_toplevel_listener, NULL);
+    if (camera_count > 1) {
+        snprintf(title, sizeof(title), "OpenCV Window - %s", camera->device);
+    } else {
+        snprintf(title, sizeof(title), "OpenCV Window");
+    }
+    xdg_toplevel_set_title(camera->xdg_toplevel, title);
+    wl_surface_set_user_data(camera->surface, camera->xdg_toplevel);
+
+    wl_surface_commit(camera->surface);
+    return 0;
+}
 
+//Release a camera and its window, safe on a partially opened one
+static void close_camera(struct camera_stream *camera) {
+    capture_close(&camera->cam);
+    frame_pacer_destroy(&camera->pacer);
+    surface_transform_destroy(&camera->transform);
+    output_buffers_destroy(&camera->outputs);
+    if (camera->xdg_toplevel) {
+        xdg_toplevel_destroy(camera->xdg_toplevel);
+    }
+    if (camera->xdg_surface) {
+        xdg_surface_destroy(camera->xdg_surface);
+    }
+    if (camera->surface) {
+        wl_surface_destroy(camera->surface);
+    }
+}
+
+static void close_cameras(void) {
+    for (int i = 0; i < camera_count; i++) {
+        close_camera(&cameras[i]);
+    }
+}
+
+//True while the previous frame of the camera is on the scheduler or its
+//window waits for the frame callback
+static bool camera_busy(const struct camera_stream *camera) {
+    return (scheduler && scheduler->busy(camera->index)) || !frame_pacer_ready(&camera->pacer);
+}
+
+//Convert, rotate and commit the pending frame of a camera, -1 on error
+static int start_frame(struct camera_stream *camera) {
+    static unsigned long frame_count = 0;
+    static unsigned long alloc_last = 0;
+    struct v4l2_buffer *buf = &camera->pending_buf;
+    unsigned char *frame = (unsigned char*)camera->cam.buffers[buf->index].data;
+
+    //The compositor still holds every buffer: the frame goes back unseen
+    camera->pending = false;
+    camera->output = output_buffers_acquire(&camera->outputs);
+    if (!camera->output) {
+        camera->cam.stats.skipped++;
+        return capture_queue(&camera->cam, buf->index);
+    }
+    unsigned char *shm_data = (unsigned char*)camera->output->data;
+    frame_pacer_begin(&camera->pacer);
+    camera->frame_latency = latency_begin(&latency, buf);
+
+    //The 4 byte formats and kernel_dst are written in place, the others are
+    //packed from a BGRA frame. The engines convert and rotate in one pass,
+    //the latency is only stamped once the output frame is ready.
+    int quarters;
+    int angle = backend_angle(camera, &quarters);
+    if (surface_transform_set(&camera->transform, camera->surface, quarters)) {
+        output_buffers_invalidate(&camera->outputs);
+    }
+    camera->job.count = 0;
+    if (output_format == OUTPUT_NV12 || (output_format == OUTPUT_RGB565 && kernel_dst != DST_RGB565)) {
+        Convert_Rotate(&camera->ctx, frame, width, height, nullptr, angle, &camera->job);
+        Pack_Output(&camera->ctx, shm_data, &camera->job);
+    } else {
+        Convert_Rotate(&camera->ctx, frame, width, height, shm_data, angle, &camera->job);
+    }
+    Run_Frame(camera, &camera->job, height, [camera] {
+        latency_stamp(camera->frame_latency, LATENCY_ROTATE);
+        commit_frame(camera);
+    });
+
+    //Heap allocations made by the frame processing, the first period includes warm-up
+    if (alloc_counter_enabled() && ++frame_count % ALLOC_REPORT_FRAMES == 0) {
+        unsigned long count = alloc_count();
+        printf("Heap allocations in frame loop: %lu over the last %d frames\n", count - alloc_last, ALLOC_REPORT_FRAMES);
+        alloc_last = count;
+    }
+    return 0;
+}
+
+//Dequeue the newest frame of a camera. It starts at once unless the previous
+//frame of the camera is still on the scheduler or not asked for by the
+//compositor yet, then it waits as the pending frame; a newer frame replaces
+//it and it goes back to the driver unseen.
+static int receive_frame(struct camera_stream *camera) {
+    struct capture *cam = &camera->cam;
+
+    if (camera->pending) {
+        if (capture_queue(cam, camera->pending_buf.index) < 0) {
+            return -1;
+        }
+        camera->pending = false;
+        cam->stats.skipped++;
+    }
+
+    //Frames still converted by the band pool keep their buffer, the oldest
+    //are handed back to the driver once the pool is idle. A camera busy on
+    //the scheduler only keeps its newest buffer, the one being processed.
+    if (band_pool) {
+        band_pool->wait_idle();
+    }
+    if (capture_trim(cam) < 0) {
+        return -1;
+    }
+
+    if (capture_dequeue(cam, &camera->pending_buf) < 0) {
+        return errno == EAGAIN ? 0 : -1;
+    }
+    camera->pending = true;
+    if (!camera_busy(camera) && start_frame(camera) < 0) {
+        return -1;
+    }
+
+    if (capture_stats_interval > 0 && cam->stats.frames % capture_stats_interval == 0) {
+        if (camera_count > 1) {
+            printf("%s: ", camera->device);
+        }
+        capture_print_stats(cam);
+        if (camera_count > 1) {
+            printf("%s: ", camera->device);
+        }
+        output_buffers_print_stats(&camera->outputs);
+    }
+    return 0;
+}
 
 /************************ MAIN FUNCTION ******************************/
 int main(int argc, char *argv[]) {
+    //Offline engine comparison, no camera or display needed
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return run_benchmark(argc > 2 ? atoi(argv[2]) : BENCH_FRAMES_DEFAULT);
+    }
+
     //Verify arguments
-    if (argc != 5) {
-        printf("Ussage: ./app, v4l2 device, width, height, angle\n");
+    if (argc < 5) {
+        print_usage();
         return 1;
     }
     
     //Initialize variables with arguments
-    char *camera_device = argv[1];    
+    for (int i = 0; i < MAX_CAMERAS; i++) {
+        cameras[i].index = i;
+        cameras[i].cam.fd = -1;
+    }
+    cameras[0].device = argv[1];
     width = atoi(argv[2]);
     height = atoi(argv[3]);
-    angle_deg = atoi(argv[4]);
+    cameras[0].angle = atoi(argv[4]);
+    if (parse_options(argc, argv) < 0) {
+        print_usage();
+        return 1;
+    }
+    if (latency_init(&latency, "opencv", latency_interval, latency_log) < 0) {
+        return 1;
+    }
+    plan_cache = new RotationPlanCache(plan_cache_mb << 20, engine, (enum rotate_quality)quality);
+    if (pool_threads <= 0) {
+        pool_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (engine == ENGINE_FUSED) {
+        printf("Using fused conversion/rotation kernel (%s)\n", fused_kernel_name());
+    } else if (engine == ENGINE_SHEAR) {
+        printf("Using three shear rotation (%s)\n", fused_kernel_name());
+    } else if (engine == ENGINE_YUV) {
+        printf("Using YUV plane rotation (%s)\n", fused_kernel_name());
+    }
+    int bands = pool_bands > 0 ? pool_bands : pool_threads * BANDS_PER_THREAD;
+    if (pool_threads > 1 && camera_count > 1) {
+        scheduler = new FrameScheduler(pool_threads, bands, camera_count, pool_cpus);
+        scheduler->set_stats_interval(band_stats_interval);
+        printf("Frame scheduler: %d threads, %d bands, %d cameras\n", scheduler->threads(), scheduler->bands(),
+               camera_count);
+    } else if (pool_threads > 1) {
+        band_pool = new BandPool(pool_threads, bands, pool_cpus);
+        band_pool->set_stats_interval(band_stats_interval);
+        printf("Band pool: %d threads, %d bands\n", band_pool->threads(), band_pool->bands());
+    }
+    //Threading is done by the band pool, OpenCV's own pool allocates a job per call
+    setNumThreads(1);
 
-    //Adding threads initialization for messageQ
+    //Initialization for messageQ, read by the event loop
     mqd_t mq;
     struct mq_attr attr;
-    pthread_t receiver_tid;
-    receiver_data_t receiver_data;
  
     //Initialize queue attributes
     attr.mq_flags = 0;
@@ -250,21 +1134,11 @@ int main(int argc, char *argv[]) {
     attr.mq_curmsgs = 0;
  
     //Open the message queue
-    mq = mq_open(QUEUE_NAME, O_RDONLY, 0644, &attr);
+    mq = mq_open(QUEUE_NAME, O_RDONLY | O_NONBLOCK, 0644, &attr);
     if (mq == (mqd_t)-1) {
         perror("mq_open");
         exit(1);
     }
- 
-    //Prepare data for receiver thread
-    receiver_data.mq = mq;
- 
-    //Create the receiver thread
-    if (pthread_create(&receiver_tid, NULL, receiver_thread, &receiver_data) != 0) {
-        perror("pthread_create");
-        mq_close(mq);
-        exit(1);
-    }
 
     //Connect to Wayland display
     display = wl_display_connect(NULL);
@@ -290,171 +1164,117 @@ int main(int argc, char *argv[]) {
  
     xdg_wm_base_add_listener(xdg_wm_base_1, &xdg_wm_base_listener, NULL);
     wl_seat_add_listener(seat, &seat_listener, NULL);
- 
-    //Open USB camera
-    int cam_fd = open(camera_device, O_RDWR);
-    if (cam_fd < 0) {
-        perror("Failed to open camera");
-        wl_display_disconnect(display);
-        return 1;
-    }
- 
-    //Configure camera format
-    struct v4l2_format fmt = {0};
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = width;
-    fmt.fmt.pix.height = height;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_ANY;
-    if (ioctl(cam_fd, VIDIOC_S_FMT, &fmt) < 0) {
-        perror("Failed to set format");
-        close(cam_fd);
-        wl_display_disconnect(display);
-        return 1;
-    }
- 
-    //Request V4L2 buffers
-    struct v4l2_requestbuffers req = {0};
-    req.count = 4;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    if (ioctl(cam_fd, VIDIOC_REQBUFS, &req) < 0) {
-        perror("Failed to request buffers");
-        close(cam_fd);
+
+    //Collect the wl_shm and linux-dmabuf formats, then pick the output format.
+    //It is negotiated against wl_shm, the fallback must be able to show it.
+    wl_display_roundtrip(display);
+    if (output_format_negotiate(&shm_formats, output_format, &output_format) < 0) {
         wl_display_disconnect(display);
         return 1;
     }
- 
-    //Map V4L2 buffers
-    void *cam_buffers[req.count];
-    struct v4l2_buffer buf;
-    size_t cam_buffer_lengths[req.count];
-    for (unsigned int i = 0; i < req.count; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        if (ioctl(cam_fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            perror("Failed to query buffer");
-            close(cam_fd);
+    printf("Output format: %s\n", output_format_name(output_format));
+    if (output_memory != OUTPUT_SHM && !(dmabuf && (dmabuf_formats.mask & (1u << output_format)))) {
+        if (output_memory == OUTPUT_DMABUF) {
+            fprintf(stderr, "The compositor does not import %s dma-bufs\n", output_format_name(output_format));
             wl_display_disconnect(display);
             return 1;
         }
-        cam_buffers[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, cam_fd, buf.m.offset);
-        cam_buffer_lengths[i] = buf.length;
-        if (cam_buffers[i] == MAP_FAILED) {
-            perror("Failed to mmap buffer");
-            close(cam_fd);
+        output_memory = OUTPUT_SHM;
+    }
+    if (compositor_rotation && !viewporter) {
+        fprintf(stderr, "No wp_viewporter, quarter turned frames are shown unscaled\n");
+    }
+ 
+    //Open the cameras
+    for (int i = 0; i < camera_count; i++) {
+        if (open_camera(&cameras[i]) < 0) {
+            close_cameras();
             wl_display_disconnect(display);
             return 1;
         }
     }
+
+    //The fused kernels write RGB565 directly, the other engines pack a BGRA frame
+    if (engine == ENGINE_FUSED && output_format == OUTPUT_RGB565) {
+        kernel_dst = DST_RGB565;
+    }
+    for (int i = 0; i < camera_count; i++) {
+        Convert_Rotate_Init(&cameras[i].ctx, width, height);
+    }
  
-    //Queue V4L2 buffers
-    for (unsigned int i = 0; i < req.count; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        if (ioctl(cam_fd, VIDIOC_QBUF, &buf) < 0) {
-            perror("Failed to queue buffer");
-            close(cam_fd);
+    //Start streaming and create the windows
+    for (int i = 0; i < camera_count; i++) {
+        if (capture_start(&cameras[i].cam) < 0 || create_window(&cameras[i]) < 0) {
+            close_cameras();
             wl_display_disconnect(display);
             return 1;
         }
     }
+    
+    // Set the current toplevel for mouse interaction
+    current_toplevel = cameras[0].xdg_toplevel;
  
-    //Start streaming
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(cam_fd, VIDIOC_STREAMON, &type) < 0) {
-        perror("Failed to start streaming");
-        close(cam_fd);
-        wl_display_disconnect(display);
-        return 1;
-    }
- 
-    //Create Wayland shared memory buffer
-    int stride = width * 4;
-    int size = stride * height;
- 
-    int shm_fd = memfd_create("wayland-shm", 0);
-    if (shm_fd < 0) {
-        perror("memfd_create failed");
-        close(cam_fd);
-        wl_display_disconnect(display);
-        return 1;
-    }
-    if (ftruncate(shm_fd, size) < 0) {
-        perror("ftruncate failed");
-        close(shm_fd);
-        close(cam_fd);
-        wl_display_disconnect(display);
-        return 1;
+    //Event loop: camera frames, angle messages, completed frame jobs, camera
+    //watchdog and Wayland events
+    struct event_loop loop;
+    bool loop_ready = event_loop_init(&loop, display) == 0 && event_loop_add(&loop, mq, SOURCE_MESSAGES) == 0 &&
+                      event_loop_add_timer(&loop, WATCHDOG_MS, SOURCE_WATCHDOG) == 0 &&
+                      (!scheduler || event_loop_add(&loop, scheduler->completion_fd(), SOURCE_JOBS) == 0);
+    for (int i = 0; i < camera_count && loop_ready; i++) {
+        loop_ready = event_loop_add(&loop, cameras[i].cam.fd, SOURCE_CAMERA + i) == 0;
     }
- 
-    void *shm_data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    if (shm_data == MAP_FAILED) {
-        perror("mmap failed");
-        close(shm_fd);
-        close(cam_fd);
+    if (!loop_ready) {
+        event_loop_close(&loop);
+        delete scheduler;
+        close_cameras();
         wl_display_disconnect(display);
         return 1;
     }
- 
-    struct wl_shm_pool *pool = wl_shm_create_pool(shm, shm_fd, size);
-    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    close(shm_fd);
- 
-    //Add buffer listener
-    wl_buffer_add_listener(buffer, &buffer_listener, NULL);
- 
-    //Create Wayland surface and xdg toplevel
-    struct wl_surface *surface = wl_compositor_create_surface(compositor);
-    struct xdg_surface *xdg_surface = xdg_wm_base_get_xdg_surface(xdg_wm_base_1, surface);
-    xdg_surface_add_listener(xdg_surface, &xdg_surface_listener, NULL);
-    struct xdg_toplevel *xdg_toplevel = xdg_surface_get_toplevel(xdg_surface);
-    xdg_toplevel_add_listener(xdg_toplevel, &xdg_toplevel_listener, NULL);
-    xdg_toplevel_set_title(xdg_toplevel, "OpenCV Window");
-    
-    // Set the current toplevel for mouse interaction
-    current_toplevel = xdg_toplevel;
-    
-    wl_surface_commit(surface);
- 
+
     printf("\nInitializations completed (including OpenCV and messageQ),\nentering to the loop...\n");
 
-    //Main loop: capture and display frames
-    while (wl_display_dispatch(display) != -1) {
+    //Main loop: the newest frame of each camera is processed as soon as its
+    //window asks for a frame (on arrival with --pacing=capture)
+    uint32_t ready;
+    bool failed = false;
+    while (!failed && event_loop_wait(&loop, &ready) == 0) {
 
-        //Dequeue a frame
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        if (ioctl(cam_fd, VIDIOC_DQBUF, &buf) < 0) {
-            perror("Failed to dequeue buffer");
+        //Angle messages, the exit message ends the loop
+        if ((ready & EVENT_SOURCE(SOURCE_MESSAGES)) && read_angle_messages(mq) != 0) {
             break;
         }
-  
-        //Requeue the buffer
-        if (ioctl(cam_fd, VIDIOC_QBUF, &buf) < 0) {
-            perror("Failed to queue buffer");
-            break;
+
+        //Camera watchdog
+        if (ready & EVENT_SOURCE(SOURCE_WATCHDOG)) {
+            for (int i = 0; i < camera_count; i++) {
+                struct camera_stream *camera = &cameras[i];
+                if (camera->cam.stats.frames + camera->cam.stats.torn == camera->watchdog_frames) {
+                    fprintf(stderr, "No frame from %s for %d ms\n", camera->device, WATCHDOG_MS);
+                }
+                camera->watchdog_frames = camera->cam.stats.frames + camera->cam.stats.torn;
+            }
         }
-       
-        //Perform OpenCV conversion
-        Convert_Rotate((unsigned char*)cam_buffers[buf.index], width, height, (unsigned char*)shm_data, angle_deg);
 
-        //Update Wayland surface
-        wl_surface_attach(surface, buffer, 0, 0);
-		wl_surface_damage(surface, 0, 0, width, height);
-        wl_surface_commit(surface);
-        wl_display_flush(display);
+        //Frame jobs completed, the frames waiting for them can start below
+        if (ready & EVENT_SOURCE(SOURCE_JOBS)) {
+            uint64_t completed;
+            if (read(scheduler->completion_fd(), &completed, sizeof(completed)) < 0 && errno != EAGAIN) {
+                perror("Failed to read completed jobs");
+                break;
+            }
+        }
+
+        for (int i = 0; i < camera_count && !failed; i++) {
+            struct camera_stream *camera = &cameras[i];
+            if (ready & EVENT_SOURCE(SOURCE_CAMERA + i)) {
+                failed = receive_frame(camera) < 0;
+            } else if (camera->pending && !camera_busy(camera)) {
+                failed = start_frame(camera) < 0;
+            }
+        }
     }
  
-    //Wait for the receiver thread to finish
-    if (pthread_join(receiver_tid, NULL) != 0) {
-        perror("pthread_join");
-    }
+    event_loop_close(&loop);
  
     //Close the queue
     if (mq_close(mq) == -1) {
@@ -463,21 +1283,25 @@ int main(int argc, char *argv[]) {
     }
 
     //Cleanup
-    ioctl(cam_fd, VIDIOC_STREAMOFF, &type);
-    for (unsigned int i = 0; i < req.count; i++) {
-        munmap(cam_buffers[i], cam_buffer_lengths[i]);
+    delete scheduler;
+    delete band_pool;
+    delete plan_cache;
+    latency_close(&latency);
+    if (presentation) {
+        wp_presentation_destroy(presentation);
+    }
+    close_cameras();
+    if (dmabuf) {
+        zwp_linux_dmabuf_v1_destroy(dmabuf);
+    }
+    if (viewporter) {
+        wp_viewporter_destroy(viewporter);
     }
-    close(cam_fd);
     wl_pointer_destroy(pointer);
     wl_seat_destroy(seat);
-    wl_buffer_destroy(buffer);
-    munmap(shm_data, size);
-    xdg_toplevel_destroy(xdg_toplevel);
-    xdg_surface_destroy(xdg_surface);
-    wl_surface_destroy(surface);
     xdg_wm_base_destroy(xdg_wm_base_1);
     wl_shm_destroy(shm);
     wl_compositor_destroy(compositor);
     wl_display_disconnect(display);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,687 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+#include <linux/videodev2.h>
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_neon.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "rotate_kernels_impl.hpp"
+
+typedef void (*yuyv_convert_fn)(const uint8_t *, int, uint8_t *);
+typedef void (*lerp_row_fn)(const uint8_t *, int, int, uint8_t *);
+typedef void (*lerp_columns_fn)(const uint8_t *, int, const int32_t *, const uint8_t *, int, int, uint8_t *, int);
+
+struct fused_kernel {
+    const char *name;
+    const struct fused_chunk_rows *chunked;     //nullptr: scalar template kernels
+    yuyv_convert_fn convert;
+    lerp_row_fn lerp;
+    lerp_columns_fn columns;
+};
+
+//Source formats, in rotate_src_format order
+static const struct {
+    const char *name;
+    uint32_t fourcc;
+    int bytes_per_pixel;    //Of the packed data or of the Y plane
+} src_formats[SRC_FORMAT_COUNT] = {
+    {"yuyv", V4L2_PIX_FMT_YUYV, 2},
+    {"uyvy", V4L2_PIX_FMT_UYVY, 2},
+    {"nv12", V4L2_PIX_FMT_NV12, 1},
+    {"grey", V4L2_PIX_FMT_GREY, 1},
+};
+
+//Output tile of the 90/270 degree transpose, 32x32 BGRA = 4 KiB stays in L1
+#define TRANSPOSE_TILE 32
+//Source pixels converted at once by the 180 degree reverse copy
+#define REVERSE_CHUNK 256
+//Pixels interleaved back to YUYV at once by planar_convert_row()
+#define PLANAR_CHUNK 256
+//Opaque black as a little endian BGRA word
+#define BG_BGRA 0xff000000u
+//Two black RGB565 pixels
+#define BG_RGB565 0u
+
+static int32_t to_q16(double v)
+{
+    return (int32_t)lround(v * 65536.0);
+}
+
+void rotate_map_init(struct rotate_map *map, int w, int h, int angle)
+{
+    //Same convention as getRotationMatrix2D(center, 360-angle, 1.0) in Convert_Rotate()
+    double theta = (360 - (angle % 360)) * M_PI / 180.0;
+    double a = cos(theta);
+    double b = sin(theta);
+    double cx = w / 2;
+    double cy = h / 2;
+
+    //Inverse of the rotation around (cx, cy): src = R^T * (dst - c) + c
+    map->xx = to_q16(a);
+    map->xy = to_q16(-b);
+    map->x0 = to_q16(cx - a * cx + b * cy);
+    map->yx = to_q16(b);
+    map->yy = to_q16(a);
+    map->y0 = to_q16(cy - b * cx - a * cy);
+}
+
+//floor(a / b) and ceil(a / b) for b > 0
+static int64_t floor_div(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int64_t ceil_div(int64_t a, int64_t b)
+{
+    return -floor_div(-a, b);
+}
+
+//Range [*lo, *hi) of x in [0, n) for which lo_v <= a + k*x < hi_v
+static void linear_range(int64_t a, int64_t k, int64_t lo_v, int64_t hi_v, int n, int *lo, int *hi)
+{
+    int64_t l, h;
+
+    if (k == 0) {
+        l = a >= lo_v && a < hi_v ? 0 : n;
+        h = n;
+    } else if (k > 0) {
+        l = ceil_div(lo_v - a, k);
+        h = ceil_div(hi_v - a, k);
+    } else {
+        l = floor_div(a - hi_v, -k) + 1;
+        h = floor_div(a - lo_v, -k) + 1;
+    }
+    l = l < 0 ? 0 : (l > n ? n : l);
+    h = h < l ? l : (h > n ? n : h);
+    *lo = (int)l;
+    *hi = (int)h;
+}
+
+void rotate_spans_init(struct rotate_span *spans, const struct rotate_map *map, int src_w, int src_h,
+                       int dst_w, int dst_h, bool nearest, int margin)
+{
+    //Q16 source positions that still reach a source pixel:
+    //bilinear floor(s) in [-1, size), nearest round(s) in [0, size)
+    int64_t lo = (nearest ? -0x8000 : -0x10000) - ((int64_t)margin << 16);
+    int64_t hi = (nearest ? -0x8000 : 0) + ((int64_t)margin << 16);
+    int64_t hi_x = ((int64_t)src_w << 16) + hi;
+    int64_t hi_y = ((int64_t)src_h << 16) + hi;
+
+    for (int y = 0; y < dst_h; y++) {
+        int x0, x1, y0, y1;
+        linear_range((int64_t)map->xy * y + map->x0, map->xx, lo, hi_x, dst_w, &x0, &x1);
+        linear_range((int64_t)map->yy * y + map->y0, map->yx, lo, hi_y, dst_w, &y0, &y1);
+
+        spans[y].begin = x0 > y0 ? x0 : y0;
+        spans[y].end = x1 < y1 ? x1 : y1;
+        if (spans[y].begin >= spans[y].end) {
+            spans[y].begin = spans[y].end = 0;
+        }
+    }
+}
+
+//Background pixels of 'bpp' bytes, 'word' holding 4 / bpp of them. The aligned
+//body uses non-temporal stores so the background does not evict the source
+//from the cache
+static void fill_pixels(uint8_t *out, int n, int bpp, uint32_t word)
+{
+    size_t bytes = (size_t)n * bpp;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i bg = _mm_set1_epi32((int)word);
+    for (; i < bytes && ((uintptr_t)(out + i) & 15); i += bpp) {
+        memcpy(out + i, &word, bpp);
+    }
+    for (; i + 16 <= bytes; i += 16) {
+        _mm_stream_si128((__m128i *)(out + i), bg);
+    }
+#elif defined(__aarch64__)
+    const uint32x4_t bg = vdupq_n_u32(word);
+    for (; i < bytes && ((uintptr_t)(out + i) & 15); i += bpp) {
+        memcpy(out + i, &word, bpp);
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        __asm__ volatile("stnp %q1, %q1, [%0]" : : "r"(out + i), "w"(bg) : "memory");
+    }
+#endif
+    for (; i < bytes; i += bpp) {
+        memcpy(out + i, &word, bpp);
+    }
+}
+
+//Opaque black BGRA pixels
+static void fill_bg(uint8_t *out, int n)
+{
+    fill_pixels(out, n, 4, BG_BGRA);
+}
+
+//Make the non-temporal stores visible before the frame is handed over
+static inline void fill_bg_fence(void)
+{
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
+void rotate_fill_background(const struct fused_frame *f, int row_begin, int row_end)
+{
+    int bpp = f->dst_format == DST_RGB565 ? 2 : 4;
+    uint32_t word = f->dst_format == DST_RGB565 ? BG_RGB565 : BG_BGRA;
+
+    for (int y = row_begin; y < row_end; y++) {
+        uint8_t *out = f->dst + (size_t)y * f->dst_stride;
+        int begin, end;
+
+        fused_row_span(f, y, &begin, &end);
+        fill_pixels(out, begin, bpp, word);
+        fill_pixels(out + (size_t)end * bpp, f->dst_width - end, bpp, word);
+    }
+    fill_bg_fence();
+}
+
+void rotate_fill_uncovered(const struct fused_frame *f, const struct rotate_span *previous, int row_begin,
+                           int row_end)
+{
+    int bpp = f->dst_format == DST_RGB565 ? 2 : 4;
+    uint32_t word = f->dst_format == DST_RGB565 ? BG_RGB565 : BG_BGRA;
+
+    if (!previous) {
+        rotate_fill_background(f, row_begin, row_end);
+        return;
+    }
+    for (int y = row_begin; y < row_end; y++) {
+        uint8_t *out = f->dst + (size_t)y * f->dst_stride;
+        int begin, end;
+
+        //Parts of the previous span left and right of the new one
+        fused_row_span(f, y, &begin, &end);
+        int left_end = previous[y].end < begin ? previous[y].end : begin;
+        int right_begin = previous[y].begin > end ? previous[y].begin : end;
+        if (left_end > previous[y].begin) {
+            fill_pixels(out + (size_t)previous[y].begin * bpp, left_end - previous[y].begin, bpp, word);
+        }
+        if (previous[y].end > right_begin) {
+            fill_pixels(out + (size_t)right_begin * bpp, previous[y].end - right_begin, bpp, word);
+        }
+    }
+    fill_bg_fence();
+}
+
+static void yuyv_convert_rows_scalar(const uint8_t *src, int pairs, uint8_t *out)
+{
+    yuyv_convert_scalar(src, 0, pairs, out);
+}
+
+static void lerp_row_scalar(const uint8_t *src, int pixels, int weight, uint8_t *out)
+{
+    lerp_bytes_scalar(src, 0, pixels * 4, weight, out);
+}
+
+static void lerp_columns_rows_scalar(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights,
+                                     int pixels, int rows, uint8_t *out, int out_stride)
+{
+    lerp_columns_scalar(src, stride, offsets, weights, 0, pixels, rows, out, out_stride);
+}
+
+//Interpolations of the scalar kernels: Y/U/V at source position (sx, sy) in Q16
+struct interp_nearest {
+    template <class Src>
+    static inline void sample(const struct fused_frame *f, int32_t sx, int32_t sy, int *y, int *u, int *v)
+    {
+        uint8_t py, pu, pv;
+        fused_fetch<Src>(f, (sx + 0x8000) >> 16, (sy + 0x8000) >> 16, &py, &pu, &pv);
+        *y = py;
+        *u = pu;
+        *v = pv;
+    }
+};
+
+struct interp_q8 {
+    template <class Src>
+    static inline void sample(const struct fused_frame *f, int32_t sx, int32_t sy, int *y, int *u, int *v)
+    {
+        uint8_t py[4], pu[4], pv[4];
+        int x0 = sx >> 16;
+        int y0 = sy >> 16;
+        int wx = (sx >> 8) & 0xff;
+        int wy = (sy >> 8) & 0xff;
+
+        fused_fetch<Src>(f, x0,     y0,     &py[0], &pu[0], &pv[0]);
+        fused_fetch<Src>(f, x0 + 1, y0,     &py[1], &pu[1], &pv[1]);
+        fused_fetch<Src>(f, x0,     y0 + 1, &py[2], &pu[2], &pv[2]);
+        fused_fetch<Src>(f, x0 + 1, y0 + 1, &py[3], &pu[3], &pv[3]);
+        *y = fused_blend(py[0], py[1], py[2], py[3], wx, wy);
+        *u = fused_blend(pu[0], pu[1], pu[2], pu[3], wx, wy);
+        *v = fused_blend(pv[0], pv[1], pv[2], pv[3], wx, wy);
+    }
+};
+
+struct interp_q16 {
+    template <class Src>
+    static inline void sample(const struct fused_frame *f, int32_t sx, int32_t sy, int *y, int *u, int *v)
+    {
+        uint8_t py[4], pu[4], pv[4];
+        int x0 = sx >> 16;
+        int y0 = sy >> 16;
+        int wx = sx & 0xffff;
+        int wy = sy & 0xffff;
+
+        fused_fetch<Src>(f, x0,     y0,     &py[0], &pu[0], &pv[0]);
+        fused_fetch<Src>(f, x0 + 1, y0,     &py[1], &pu[1], &pv[1]);
+        fused_fetch<Src>(f, x0,     y0 + 1, &py[2], &pu[2], &pv[2]);
+        fused_fetch<Src>(f, x0 + 1, y0 + 1, &py[3], &pu[3], &pv[3]);
+        *y = blend_q16(py[0], py[1], py[2], py[3], wx, wy);
+        *u = blend_q16(pu[0], pu[1], pu[2], pu[3], wx, wy);
+        *v = blend_q16(pv[0], pv[1], pv[2], pv[3], wx, wy);
+    }
+};
+
+//One pixel at a time, every format and interpolation. Used directly for Q16
+//and on CPUs without SIMD, and as the reference of the chunked kernels.
+template <class Src, class Dst, class Interp>
+static void rotate_rows_scalar(const struct fused_frame *f, int row_begin, int row_end)
+{
+    const struct rotate_map *m = &f->map;
+
+    for (int y = row_begin; y < row_end; y++) {
+        int begin, end;
+        fused_row_span(f, y, &begin, &end);
+        int32_t sx = m->xx * begin + m->xy * y + m->x0;
+        int32_t sy = m->yx * begin + m->yy * y + m->y0;
+        uint8_t *out = f->dst + (size_t)y * f->dst_stride;
+
+        for (int x = begin; x < end; x++) {
+            int py, pu, pv;
+            Interp::template sample<Src>(f, sx, sy, &py, &pu, &pv);
+            Dst::store(py, pu, pv, out + (size_t)x * Dst::bpp);
+            sx += m->xx;
+            sy += m->yx;
+        }
+    }
+}
+
+//Scalar kernels, indexed [src][dst][quality] in enum order
+#define SCALAR_DST(src, dst) \
+    {rotate_rows_scalar<src, dst, interp_nearest>, rotate_rows_scalar<src, dst, interp_q8>, \
+     rotate_rows_scalar<src, dst, interp_q16>}
+#define SCALAR_SRC(src) {SCALAR_DST(src, dst_bgra), SCALAR_DST(src, dst_rgb565)}
+
+static const rotate_rows_fn scalar_rows[SRC_FORMAT_COUNT][DST_FORMAT_COUNT][QUALITY_Q16 + 1] = {
+    SCALAR_SRC(src_yuyv), SCALAR_SRC(src_uyvy), SCALAR_SRC(src_nv12), SCALAR_SRC(src_grey),
+};
+
+//Pick the best variant supported by the running CPU
+static struct fused_kernel select_kernel(void)
+{
+#if defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMD) {
+        return (struct fused_kernel){"neon", &fused_chunk_rows_neon, yuyv_convert_neon, lerp_row_neon,
+                                     lerp_columns_neon};
+    }
+#elif defined(__ARM_NEON)
+    return (struct fused_kernel){"neon", &fused_chunk_rows_neon, yuyv_convert_neon, lerp_row_neon, lerp_columns_neon};
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return (struct fused_kernel){"avx2", &fused_chunk_rows_avx2, yuyv_convert_avx2, lerp_row_avx2,
+                                     lerp_columns_avx2};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return (struct fused_kernel){"sse4.1", &fused_chunk_rows_sse41, yuyv_convert_sse41, lerp_row_sse41,
+                                     lerp_columns_sse41};
+    }
+#endif
+    return (struct fused_kernel){"scalar", nullptr, yuyv_convert_rows_scalar, lerp_row_scalar, lerp_columns_rows_scalar};
+}
+
+static const struct fused_kernel &active_kernel(void)
+{
+    static const struct fused_kernel kernel = select_kernel();
+    return kernel;
+}
+
+int rotate_src_format_from_fourcc(uint32_t fourcc, enum rotate_src_format *format)
+{
+    for (int i = 0; i < SRC_FORMAT_COUNT; i++) {
+        if (src_formats[i].fourcc == fourcc) {
+            *format = (enum rotate_src_format)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+uint32_t rotate_src_format_fourcc(enum rotate_src_format format)
+{
+    return src_formats[format].fourcc;
+}
+
+const char *rotate_src_format_name(enum rotate_src_format format)
+{
+    return src_formats[format].name;
+}
+
+int rotate_src_stride(enum rotate_src_format format, int width)
+{
+    return width * src_formats[format].bytes_per_pixel;
+}
+
+size_t rotate_src_size(enum rotate_src_format format, int width, int height)
+{
+    size_t size = (size_t)rotate_src_stride(format, width) * height;
+
+    //NV12: the chroma plane follows the luma plane with the same stride
+    return format == SRC_NV12 ? size + (size_t)width * ((height + 1) / 2) : size;
+}
+
+rotate_rows_fn rotate_kernel_select(enum rotate_src_format src, enum rotate_dst_format dst,
+                                    enum rotate_quality quality)
+{
+    const struct fused_chunk_rows *chunked = active_kernel().chunked;
+
+    if (quality == QUALITY_FLOAT) {
+        quality = QUALITY_Q16;
+    }
+    if (chunked && quality <= QUALITY_Q8) {
+        return chunked->rows[src][dst][quality];
+    }
+    return scalar_rows[src][dst][quality];
+}
+
+void fused_rotate_rows(const struct fused_frame *frame, int row_begin, int row_end)
+{
+    rotate_kernel_select(frame->src_format, frame->dst_format, QUALITY_Q8)(frame, row_begin, row_end);
+}
+
+void fused_rotate_rows_scalar(const struct fused_frame *frame, int row_begin, int row_end)
+{
+    scalar_rows[frame->src_format][frame->dst_format][QUALITY_Q8](frame, row_begin, row_end);
+}
+
+void fused_nearest_rows(const struct fused_frame *frame, int row_begin, int row_end)
+{
+    rotate_kernel_select(frame->src_format, frame->dst_format, QUALITY_NEAREST)(frame, row_begin, row_end);
+}
+
+void fused_nearest_rows_scalar(const struct fused_frame *frame, int row_begin, int row_end)
+{
+    scalar_rows[frame->src_format][frame->dst_format][QUALITY_NEAREST](frame, row_begin, row_end);
+}
+
+void fused_rotate_rows_q16(const struct fused_frame *frame, int row_begin, int row_end)
+{
+    scalar_rows[frame->src_format][frame->dst_format][QUALITY_Q16](frame, row_begin, row_end);
+}
+
+void yuyv_convert(const uint8_t *src, int pairs, uint8_t *out)
+{
+    active_kernel().convert(src, pairs, out);
+}
+
+void lerp_row(const uint8_t *src, int pixels, int weight, uint8_t *out)
+{
+    if (weight == 0) {
+        memcpy(out, src, (size_t)pixels * 4);
+        return;
+    }
+    active_kernel().lerp(src, pixels, weight, out);
+}
+
+void lerp_columns(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels, int rows,
+                  uint8_t *out, int out_stride)
+{
+    active_kernel().columns(src, stride, offsets, weights, pixels, rows, out, out_stride);
+}
+
+void planar_convert_row(const uint8_t *y, const uint8_t *uv, int begin, int end, uint8_t *out)
+{
+    uint8_t line[PLANAR_CHUNK * 2];
+    yuyv_convert_fn convert = active_kernel().convert;
+
+    //Pixel x takes the U,V pair at uv[x & ~1]
+    if (begin < end && (begin & 1)) {
+        fused_yuv_to_bgra(y[begin], uv[begin - 1], uv[begin], out + (size_t)begin * 4);
+        begin++;
+    }
+    while (end - begin >= 2) {
+        int n = (end - begin < PLANAR_CHUNK ? end - begin : PLANAR_CHUNK) & ~1;
+        for (int i = 0; i < n; i += 2) {
+            line[i * 2] = y[begin + i];
+            line[i * 2 + 1] = uv[begin + i];
+            line[i * 2 + 2] = y[begin + i + 1];
+            line[i * 2 + 3] = uv[begin + i + 1];
+        }
+        convert(line, n / 2, out + (size_t)begin * 4);
+        begin += n;
+    }
+    if (begin < end) {
+        fused_yuv_to_bgra(y[begin], uv[begin], uv[begin + 1], out + (size_t)begin * 4);
+    }
+}
+
+void bgra_to_rgb565_row(const uint8_t *src, int pixels, uint8_t *dst)
+{
+    pack_rgb565(src, pixels, dst);
+}
+
+//BT.601 limited range RGB -> YUV in Q8
+static inline uint8_t rgb_to_y(int r, int g, int b)
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+void bgra_to_nv12_rows(const uint8_t *src, int src_stride, int w, int h, uint8_t *y_plane, uint8_t *uv_plane,
+                       int stride, int row_begin, int row_end)
+{
+    for (int y = row_begin; y < row_end; y++) {
+        const uint8_t *in = src + (size_t)y * src_stride;
+        uint8_t *out = y_plane + (size_t)y * stride;
+        for (int x = 0; x < w; x++) {
+            out[x] = rgb_to_y(in[x * 4 + 2], in[x * 4 + 1], in[x * 4]);
+        }
+    }
+
+    for (int c = (row_begin + 1) / 2; c < (row_end + 1) / 2; c++) {
+        const uint8_t *top = src + (size_t)(2 * c) * src_stride;
+        const uint8_t *bot = 2 * c + 1 < h ? top + src_stride : top;
+        uint8_t *out = uv_plane + (size_t)c * stride;
+        for (int x = 0; x + 1 < w; x += 2) {
+            int b = top[x * 4] + top[x * 4 + 4] + bot[x * 4] + bot[x * 4 + 4];
+            int g = top[x * 4 + 1] + top[x * 4 + 5] + bot[x * 4 + 1] + bot[x * 4 + 5];
+            int r = top[x * 4 + 2] + top[x * 4 + 6] + bot[x * 4 + 2] + bot[x * 4 + 6];
+            //Sums of four pixels, the extra >> 2 averages them
+            out[x] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+            out[x + 1] = (uint8_t)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+        }
+    }
+}
+
+const char *fused_kernel_name(void)
+{
+    return active_kernel().name;
+}
+
+/************************ Exact right angle kernels ******************************/
+
+//Integer form of rotate_map_init() for a multiple of 90 degrees
+//  sx = ax*x + bx*y + cx
+//  sy = ay*x + by*y + cy
+struct right_angle_map {
+    int ax, bx, cx;
+    int ay, by, cy;
+};
+
+int right_angle_quarters(int angle)
+{
+    angle %= 360;
+    if (angle < 0) {
+        angle += 360;
+    }
+    return angle % 90 == 0 ? angle / 90 : -1;
+}
+
+static void right_angle_map_init(struct right_angle_map *m, int w, int h, int quarters)
+{
+    int cx = w / 2;
+    int cy = h / 2;
+
+    switch (quarters) {
+    case 1:     //90 clockwise
+        *m = (struct right_angle_map){0, 1, cx - cy, -1, 0, cx + cy};
+        break;
+    case 2:
+        *m = (struct right_angle_map){-1, 0, 2 * cx, 0, -1, 2 * cy};
+        break;
+    case 3:     //270 clockwise
+        *m = (struct right_angle_map){0, -1, cx + cy, 1, 0, cy - cx};
+        break;
+    default:
+        *m = (struct right_angle_map){1, 0, 0, 0, 1, 0};
+        break;
+    }
+}
+
+//Range [*lo, *hi) of t in [0, n) for which s = k*t + c lies in [0, limit), k = +-1
+static void valid_range(int k, int c, int limit, int n, int *lo, int *hi)
+{
+    int a = k > 0 ? -c : c - limit + 1;
+    int b = k > 0 ? limit - c : c + 1;
+
+    *lo = a < 0 ? 0 : (a > n ? n : a);
+    *hi = b < *lo ? *lo : (b > n ? n : b);
+}
+
+//Convert n source pixels starting at (sx, sy), any alignment
+static void convert_span(const struct fused_frame *f, yuyv_convert_fn convert, int sx, int sy, int n, uint8_t *out)
+{
+    const uint8_t *row = f->src + (size_t)sy * f->src_stride;
+
+    if (n > 0 && (sx & 1)) {
+        const uint8_t *p = row + (size_t)(sx - 1) * 2;
+        fused_yuv_to_bgra(p[2], p[1], p[3], out);
+        sx++;
+        n--;
+        out += 4;
+    }
+    convert(row + (size_t)sx * 2, n / 2, out);
+    if (n & 1) {
+        const uint8_t *p = row + (size_t)(sx + n - 1) * 2;
+        fused_yuv_to_bgra(p[0], p[1], p[3], out + (size_t)(n - 1) * 4);
+    }
+}
+
+//0 degrees: straight conversion of each row
+static void rows_0(const struct fused_frame *f, yuyv_convert_fn convert, int y0, int y1, int x0, int x1)
+{
+    for (int y = y0; y < y1; y++) {
+        convert_span(f, convert, x0, y, x1 - x0, f->dst + (size_t)y * f->dst_stride + (size_t)x0 * 4);
+    }
+}
+
+//180 degrees: convert a chunk of the mirrored source row, then store it reversed
+static void rows_180(const struct fused_frame *f, const struct right_angle_map *m, yuyv_convert_fn convert,
+                     int y0, int y1, int x0, int x1)
+{
+    uint32_t tmp[REVERSE_CHUNK];
+    int s_begin = m->cx - (x1 - 1);
+    int n = x1 - x0;
+
+    for (int y = y0; y < y1; y++) {
+        uint32_t *out = (uint32_t *)(f->dst + (size_t)y * f->dst_stride);
+        for (int o = 0; o < n; o += REVERSE_CHUNK) {
+            int len = n - o < REVERSE_CHUNK ? n - o : REVERSE_CHUNK;
+            uint32_t *dst = out + m->cx - (s_begin + o);
+            convert_span(f, convert, s_begin + o, m->cy - y, len, (uint8_t *)tmp);
+            for (int i = 0; i < len; i++) {
+                dst[-i] = tmp[i];
+            }
+        }
+    }
+}
+
+//90/270 degrees: each output row is a source column. Work on square tiles,
+//converting contiguous source row segments into a small buffer that is then
+//written out transposed, so both sides stay cache friendly.
+static void rows_transpose(const struct fused_frame *f, const struct right_angle_map *m, yuyv_convert_fn convert,
+                           int y0, int y1, int x0, int x1)
+{
+    uint32_t tile[TRANSPOSE_TILE][TRANSPOSE_TILE];
+
+    for (int ty = y0; ty < y1; ty += TRANSPOSE_TILE) {
+        int th = y1 - ty < TRANSPOSE_TILE ? y1 - ty : TRANSPOSE_TILE;
+        //First source column of the tile (source columns run with y, in the direction of bx)
+        int sx = m->bx > 0 ? ty + m->cx : m->cx - (ty + th - 1);
+
+        for (int tx = x0; tx < x1; tx += TRANSPOSE_TILE) {
+            int tw = x1 - tx < TRANSPOSE_TILE ? x1 - tx : TRANSPOSE_TILE;
+
+            for (int i = 0; i < tw; i++) {
+                convert_span(f, convert, sx, m->ay * (tx + i) + m->cy, th, (uint8_t *)tile[i]);
+            }
+            for (int j = 0; j < th; j++) {
+                uint32_t *out = (uint32_t *)(f->dst + (size_t)(ty + j) * f->dst_stride) + tx;
+                int k = m->bx > 0 ? j : th - 1 - j;
+                for (int i = 0; i < tw; i++) {
+                    out[i] = tile[i][k];
+                }
+            }
+        }
+    }
+}
+
+void right_angle_rotate_rows(const struct fused_frame *f, int quarters, int row_begin, int row_end)
+{
+    yuyv_convert_fn convert = active_kernel().convert;
+    struct right_angle_map m;
+    int x0, x1, y0, y1;
+
+    //The part of the output covered by the source is a rectangle
+    right_angle_map_init(&m, f->src_width, f->src_height, quarters);
+    if (m.ax != 0) {
+        valid_range(m.ax, m.cx, f->src_width, f->dst_width, &x0, &x1);
+        valid_range(m.by, m.cy, f->src_height, f->dst_height, &y0, &y1);
+    } else {
+        valid_range(m.ay, m.cy, f->src_height, f->dst_width, &x0, &x1);
+        valid_range(m.bx, m.cx, f->src_width, f->dst_height, &y0, &y1);
+    }
+
+    //Background outside of it
+    for (int y = row_begin; y < row_end; y++) {
+        uint8_t *out = f->dst + (size_t)y * f->dst_stride;
+        if (y < y0 || y >= y1) {
+            fill_bg(out, f->dst_width);
+        } else {
+            fill_bg(out, x0);
+            fill_bg(out + (size_t)x1 * 4, f->dst_width - x1);
+        }
+    }
+    fill_bg_fence();
+
+    y0 = y0 > row_begin ? y0 : row_begin;
+    y1 = y1 < row_end ? y1 : row_end;
+    if (y0 >= y1 || x0 >= x1) {
+        return;
+    }
+    switch (quarters) {
+    case 0:
+        rows_0(f, convert, y0, y1, x0, x1);
+        break;
+    case 2:
+        rows_180(f, &m, convert, y0, y1, x0, x1);
+        break;
+    default:
+        rows_transpose(f, &m, convert, y0, y1, x0, x1);
+        break;
+    }
+}
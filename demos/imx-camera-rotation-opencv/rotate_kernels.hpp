@@ -0,0 +1,152 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Rotation engines selectable from the command line
+enum rotate_engine {
+    ENGINE_OPENCV = 0,  //cvtColor + warpAffine (baseline)
+    ENGINE_FUSED,       //Single pass YUYV sampling + BGRA conversion
+    ENGINE_SHEAR,       //Three shear (Paeth) decomposition, see shear_rotate.hpp
+    ENGINE_YUV,         //cv::remap on the Y and 4:2:0 UV planes, see yuv_rotate.hpp
+};
+
+//Interpolation of the CPU engines, traded against speed at runtime
+enum rotate_quality {
+    QUALITY_NEAREST = 0,    //Nearest neighbour, one tap per pixel
+    QUALITY_Q8,             //Bilinear, Q8 weights (SIMD)
+    QUALITY_Q16,            //Bilinear, Q16 weights with 64 bit accumulation (scalar)
+    QUALITY_FLOAT,          //OpenCV cvtColor + remap
+};
+
+//Source pixel formats of the fused kernels, see rotate_src_format_from_fourcc()
+enum rotate_src_format {
+    SRC_YUYV = 0,       //Y0 U Y1 V, 2 bytes per pixel
+    SRC_UYVY,           //U Y0 V Y1, 2 bytes per pixel
+    SRC_NV12,           //Y plane + interleaved 4:2:0 UV plane
+    SRC_GREY,           //Y plane only
+    SRC_FORMAT_COUNT,
+};
+
+//Destination pixel formats written by the fused kernels
+enum rotate_dst_format {
+    DST_BGRA = 0,       //WL_SHM_FORMAT_ARGB8888 / XRGB8888, 4 bytes per pixel
+    DST_RGB565,         //WL_SHM_FORMAT_RGB565, 2 bytes per pixel
+    DST_FORMAT_COUNT,
+};
+
+//Inverse mapping (output pixel -> source pixel) in Q16 fixed point
+//  sx = xx*x + xy*y + x0
+//  sy = yx*x + yy*y + y0
+struct rotate_map {
+    int32_t xx, xy, x0;
+    int32_t yx, yy, y0;
+};
+
+//Output columns [begin, end) of one row whose taps can reach the source.
+//Every pixel outside of it samples background only, so it is plain black.
+struct rotate_span {
+    int32_t begin;
+    int32_t end;
+};
+
+//Frame description shared by every kernel variant. Zero initialized
+//formats are YUYV in and BGRA out.
+struct fused_frame {
+    const uint8_t *src;     //Packed pixels or Y plane, see src_format
+    int src_width;
+    int src_height;
+    int src_stride;
+    uint8_t *dst;           //See dst_format
+    int dst_width;
+    int dst_height;
+    int dst_stride;
+    struct rotate_map map;
+    const struct rotate_span *spans;    //Per output row, nullptr = whole rows
+    enum rotate_src_format src_format;
+    const uint8_t *src_uv;  //NV12 chroma plane, src_stride bytes per row
+    enum rotate_dst_format dst_format;
+};
+
+typedef void (*rotate_rows_fn)(const struct fused_frame *frame, int row_begin, int row_end);
+
+//Source format of a V4L2 fourcc, -1 if the kernels do not support it
+int rotate_src_format_from_fourcc(uint32_t fourcc, enum rotate_src_format *format);
+uint32_t rotate_src_format_fourcc(enum rotate_src_format format);
+const char *rotate_src_format_name(enum rotate_src_format format);
+//Bytes per row of the packed data or of the Y plane
+int rotate_src_stride(enum rotate_src_format format, int width);
+//Bytes of a whole frame, all planes
+size_t rotate_src_size(enum rotate_src_format format, int width, int height);
+
+//Row kernel of one source format, destination format and interpolation
+//(QUALITY_NEAREST, QUALITY_Q8 or QUALITY_Q16), looked up once in a table of
+//template instances. Q8 and nearest use the SIMD variant of the running CPU.
+rotate_rows_fn rotate_kernel_select(enum rotate_src_format src, enum rotate_dst_format dst,
+                                    enum rotate_quality quality);
+
+//Build the inverse map with the same convention as Convert_Rotate()
+void rotate_map_init(struct rotate_map *map, int w, int h, int angle);
+
+//Footprint of the rotated source for every output row (dst_height spans).
+//nearest: one rounded tap per pixel instead of the bilinear 2x2 neighbourhood.
+//margin: extra source pixels counted as inside, for samplers whose rounding
+//differs from the Q16 map (cv::remap)
+void rotate_spans_init(struct rotate_span *spans, const struct rotate_map *map, int src_w, int src_h,
+                       int dst_w, int dst_h, bool nearest, int margin);
+
+//Fill rows [row_begin, row_end) outside of frame->spans with black, using
+//non-temporal stores: the background is never read back by the CPU
+void rotate_fill_background(const struct fused_frame *frame, int row_begin, int row_end);
+//Same for a buffer whose last frame wrote the 'previous' spans and is black
+//elsewhere: only the pixels of 'previous' outside frame->spans are filled.
+//previous == nullptr fills the whole background.
+void rotate_fill_uncovered(const struct fused_frame *frame, const struct rotate_span *previous, int row_begin,
+                           int row_end);
+
+//Convert and rotate output rows [row_begin, row_end) in a single pass, with
+//the kernel of the frame formats. With frame->spans, only the pixels inside
+//the spans are written.
+void fused_rotate_rows(const struct fused_frame *frame, int row_begin, int row_end);
+
+//Scalar reference, always available (used to validate the SIMD variants)
+void fused_rotate_rows_scalar(const struct fused_frame *frame, int row_begin, int row_end);
+
+//Nearest neighbour variant of fused_rotate_rows(), scalar reference
+void fused_nearest_rows(const struct fused_frame *frame, int row_begin, int row_end);
+void fused_nearest_rows_scalar(const struct fused_frame *frame, int row_begin, int row_end);
+
+//Bilinear with the full Q16 fraction of the map
+void fused_rotate_rows_q16(const struct fused_frame *frame, int row_begin, int row_end);
+
+//Exact kernels for angles that are a multiple of 90 degrees: no interpolation,
+//straight/reversed row conversion or a tiled transpose. They use the same
+//pixel mapping as rotate_map_init(), so switching paths never shifts the image.
+//Returns the number of clockwise quarter turns (0..3), or -1 for other angles
+int right_angle_quarters(int angle);
+
+//Convert and rotate output rows [row_begin, row_end) by 'quarters' * 90 degrees
+//(frame->map is not used). YUYV to BGRA only.
+void right_angle_rotate_rows(const struct fused_frame *frame, int quarters, int row_begin, int row_end);
+
+//Convert pixels [begin, end) of one row from planes to BGRA: y has one byte
+//per pixel, uv one U,V pair per two pixels (a row of NV12/NV16 chroma)
+void planar_convert_row(const uint8_t *y, const uint8_t *uv, int begin, int end, uint8_t *out);
+
+//Packing of a finished BGRA frame into the smaller Wayland output formats
+//BGRA -> RGB565 (WL_SHM_FORMAT_RGB565, little endian 16 bit words)
+void bgra_to_rgb565_row(const uint8_t *src, int pixels, uint8_t *dst);
+//BGRA -> NV12 (BT.601 limited range) for rows [row_begin, row_end) of a
+//w x h frame. Chroma row c averages rows 2c and 2c + 1 and is written by the
+//call holding row 2c, so bands can be split anywhere.
+void bgra_to_nv12_rows(const uint8_t *src, int src_stride, int w, int h, uint8_t *y_plane, uint8_t *uv_plane,
+                       int stride, int row_begin, int row_end);
+
+//Name of the variant picked at runtime ("scalar", "neon", "sse4.1", "avx2")
+const char *fused_kernel_name(void);
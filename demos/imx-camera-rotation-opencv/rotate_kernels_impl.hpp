@@ -0,0 +1,345 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <string.h>
+#include "rotate_kernels.hpp"
+
+//Internal helpers shared by the scalar and SIMD kernel variants.
+//Every variant uses the same integer math so their outputs are bit-exact.
+
+//Pixels gathered per chunk before the vector blend/convert step
+#define FUSED_CHUNK 64
+
+//BT.601 limited range YUV -> RGB in Q14 (same matrix as COLOR_YUV2BGRA_YUYV)
+#define YUV_SHIFT 14
+#define YUV_ROUND (1 << (YUV_SHIFT - 1))
+#define YUV_CY    19077     //1.164383
+#define YUV_CVR   26149     //1.596027
+#define YUV_CUG   (-6419)   //-0.391762
+#define YUV_CVG   (-13320)  //-0.812968
+#define YUV_CUB   33050     //2.017232
+
+//YUV triplet used for taps falling outside the source (black)
+#define BG_Y 16
+#define BG_U 128
+#define BG_V 128
+
+//Bilinear taps for one chunk, stored as planes so SIMD can load them directly
+//Index 0..3 = top-left, top-right, bottom-left, bottom-right
+struct fused_taps {
+    uint8_t y[4][FUSED_CHUNK];
+    uint8_t u[4][FUSED_CHUNK];
+    uint8_t v[4][FUSED_CHUNK];
+    uint16_t wx[FUSED_CHUNK];   //Q8 horizontal weight of the right taps
+    uint16_t wy[FUSED_CHUNK];   //Q8 vertical weight of the bottom taps
+};
+
+//Source formats. Each one is a type with the Y/U/V fetch of one pixel inside
+//the frame, so the kernels are instantiated per format and the pixel loops
+//never switch on it. Chroma of a 4:2:x format is shared by pixel pairs.
+struct src_yuyv {
+    static inline void fetch(const struct fused_frame *f, int x, int y, uint8_t *py, uint8_t *pu, uint8_t *pv)
+    {
+        const uint8_t *p = f->src + (size_t)y * f->src_stride + (size_t)(x & ~1) * 2;
+        *py = p[(x & 1) * 2];
+        *pu = p[1];
+        *pv = p[3];
+    }
+};
+
+struct src_uyvy {
+    static inline void fetch(const struct fused_frame *f, int x, int y, uint8_t *py, uint8_t *pu, uint8_t *pv)
+    {
+        const uint8_t *p = f->src + (size_t)y * f->src_stride + (size_t)(x & ~1) * 2;
+        *py = p[1 + (x & 1) * 2];
+        *pu = p[0];
+        *pv = p[2];
+    }
+};
+
+struct src_nv12 {
+    static inline void fetch(const struct fused_frame *f, int x, int y, uint8_t *py, uint8_t *pu, uint8_t *pv)
+    {
+        const uint8_t *uv = f->src_uv + (size_t)(y >> 1) * f->src_stride + (x & ~1);
+        *py = f->src[(size_t)y * f->src_stride + x];
+        *pu = uv[0];
+        *pv = uv[1];
+    }
+};
+
+struct src_grey {
+    static inline void fetch(const struct fused_frame *f, int x, int y, uint8_t *py, uint8_t *pu, uint8_t *pv)
+    {
+        *py = f->src[(size_t)y * f->src_stride + x];
+        *pu = BG_U;
+        *pv = BG_V;
+    }
+};
+
+//Fetch Y/U/V of one source pixel, background if outside the frame
+template <class Src>
+static inline void fused_fetch(const struct fused_frame *f, int x, int y, uint8_t *py, uint8_t *pu, uint8_t *pv)
+{
+    if ((unsigned)x < (unsigned)f->src_width && (unsigned)y < (unsigned)f->src_height) {
+        Src::fetch(f, x, y, py, pu, pv);
+    } else {
+        *py = BG_Y;
+        *pu = BG_U;
+        *pv = BG_V;
+    }
+}
+
+//Fill the four taps of chunk slot i for source position (sx, sy) in Q16
+template <class Src>
+static inline void fused_gather(const struct fused_frame *f, int32_t sx, int32_t sy, struct fused_taps *t, int i)
+{
+    int x0 = sx >> 16;
+    int y0 = sy >> 16;
+
+    t->wx[i] = (uint16_t)((sx >> 8) & 0xff);
+    t->wy[i] = (uint16_t)((sy >> 8) & 0xff);
+    fused_fetch<Src>(f, x0,     y0,     &t->y[0][i], &t->u[0][i], &t->v[0][i]);
+    fused_fetch<Src>(f, x0 + 1, y0,     &t->y[1][i], &t->u[1][i], &t->v[1][i]);
+    fused_fetch<Src>(f, x0,     y0 + 1, &t->y[2][i], &t->u[2][i], &t->v[2][i]);
+    fused_fetch<Src>(f, x0 + 1, y0 + 1, &t->y[3][i], &t->u[3][i], &t->v[3][i]);
+}
+
+//Nearest neighbour: the closest source pixel in all four taps with zero
+//weights, so the bilinear blend/convert step returns it unchanged
+template <class Src>
+static inline void fused_gather_nearest(const struct fused_frame *f, int32_t sx, int32_t sy, struct fused_taps *t, int i)
+{
+    uint8_t y, u, v;
+
+    fused_fetch<Src>(f, (sx + 0x8000) >> 16, (sy + 0x8000) >> 16, &y, &u, &v);
+    t->wx[i] = 0;
+    t->wy[i] = 0;
+    for (int k = 0; k < 4; k++) {
+        t->y[k][i] = y;
+        t->u[k][i] = u;
+        t->v[k][i] = v;
+    }
+}
+
+//Q8 bilinear blend, rounding after each direction (fits in 16 bits)
+static inline int fused_blend(int p00, int p01, int p10, int p11, int wx, int wy)
+{
+    int top = (p00 * (256 - wx) + p01 * wx + 128) >> 8;
+    int bot = (p10 * (256 - wx) + p11 * wx + 128) >> 8;
+    return (top * (256 - wy) + bot * wy + 128) >> 8;
+}
+
+//Q16 bilinear blend, the vertical pass needs 64 bits
+static inline int blend_q16(int p00, int p01, int p10, int p11, int64_t wx, int64_t wy)
+{
+    int64_t top = p00 * (65536 - wx) + p01 * wx;
+    int64_t bot = p10 * (65536 - wx) + p11 * wx;
+    return (int)((top * (65536 - wy) + bot * wy + (1LL << 31)) >> 32);
+}
+
+static inline uint8_t fused_clamp(int v)
+{
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+//Write one BGRA pixel
+static inline void fused_yuv_to_bgra(int y, int u, int v, uint8_t *out)
+{
+    int yc = (y > 16 ? y - 16 : 0) * YUV_CY + YUV_ROUND;
+    u -= 128;
+    v -= 128;
+    out[0] = fused_clamp((yc + YUV_CUB * u) >> YUV_SHIFT);
+    out[1] = fused_clamp((yc + YUV_CUG * u + YUV_CVG * v) >> YUV_SHIFT);
+    out[2] = fused_clamp((yc + YUV_CVR * v) >> YUV_SHIFT);
+    out[3] = 0xff;
+}
+
+//BGRA -> RGB565 (little endian 16 bit words) of n pixels
+static inline void pack_rgb565(const uint8_t *src, int n, uint8_t *dst)
+{
+    uint16_t *out = (uint16_t *)dst;
+    for (int i = 0; i < n; i++) {
+        const uint8_t *p = src + (size_t)i * 4;
+        out[i] = (uint16_t)((p[2] >> 3) << 11 | (p[1] >> 2) << 5 | p[0] >> 3);
+    }
+}
+
+//Destination formats: bytes per pixel, the store of one converted pixel and
+//the packing of a chunk of BGRA pixels produced by the SIMD converters
+struct dst_bgra {
+    enum { bpp = 4 };
+    static inline void store(int y, int u, int v, uint8_t *out)
+    {
+        fused_yuv_to_bgra(y, u, v, out);
+    }
+    static inline void pack(const uint8_t *bgra, int n, uint8_t *out)
+    {
+        memcpy(out, bgra, (size_t)n * 4);
+    }
+};
+
+struct dst_rgb565 {
+    enum { bpp = 2 };
+    static inline void store(int y, int u, int v, uint8_t *out)
+    {
+        uint8_t bgra[4];
+        fused_yuv_to_bgra(y, u, v, bgra);
+        pack_rgb565(bgra, 1, out);
+    }
+    static inline void pack(const uint8_t *bgra, int n, uint8_t *out)
+    {
+        pack_rgb565(bgra, n, out);
+    }
+};
+
+//Scalar blend + convert for chunk slots [begin, end), used for SIMD tails
+static inline void fused_convert_scalar(const struct fused_taps *t, int begin, int end, uint8_t *out)
+{
+    for (int i = begin; i < end; i++) {
+        int wx = t->wx[i];
+        int wy = t->wy[i];
+        int y = fused_blend(t->y[0][i], t->y[1][i], t->y[2][i], t->y[3][i], wx, wy);
+        int u = fused_blend(t->u[0][i], t->u[1][i], t->u[2][i], t->u[3][i], wx, wy);
+        int v = fused_blend(t->v[0][i], t->v[1][i], t->v[2][i], t->v[3][i], wx, wy);
+        fused_yuv_to_bgra(y, u, v, out + i * 4);
+    }
+}
+
+//Straight YUYV -> BGRA conversion of macropixels [begin, end) (2 pixels each),
+//used by the exact right angle kernels and for SIMD tails
+static inline void yuyv_convert_scalar(const uint8_t *src, int begin, int end, uint8_t *out)
+{
+    for (int i = begin; i < end; i++) {
+        const uint8_t *p = src + (size_t)i * 4;
+        fused_yuv_to_bgra(p[0], p[1], p[3], out + (size_t)i * 8);
+        fused_yuv_to_bgra(p[2], p[1], p[3], out + (size_t)i * 8 + 4);
+    }
+}
+
+//Blend every byte with the byte one BGRA pixel later, Q8 weight w in [1, 255]:
+//out[i] = (src[i] * (256 - w) + src[i + 4] * w + 128) >> 8, bytes [begin, end)
+static inline void lerp_bytes_scalar(const uint8_t *src, int begin, int end, int w, uint8_t *out)
+{
+    for (int i = begin; i < end; i++) {
+        out[i] = (uint8_t)((src[i] * (256 - w) + src[i + 4] * w + 128) >> 8);
+    }
+}
+
+//Blend BGRA pixels [begin, end) of every row of lerp_columns() one at a time, same rounding
+static inline void lerp_columns_scalar(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights,
+                                       int begin, int end, int rows, uint8_t *out, int out_stride)
+{
+    for (int r = 0; r < rows; r++) {
+        const uint8_t *row = src + (size_t)r * stride;
+        uint8_t *dst = out + (size_t)r * out_stride;
+        for (int i = begin; i < end; i++) {
+            const uint8_t *p = row + offsets[i];
+            int w = weights[i];
+            for (int c = 0; c < 4; c++) {
+                dst[i * 4 + c] = (uint8_t)((p[c] * (256 - w) + p[stride + c] * w + 128) >> 8);
+            }
+        }
+    }
+}
+
+//Columns of output row y to compute
+static inline void fused_row_span(const struct fused_frame *f, int y, int *begin, int *end)
+{
+    if (f->spans) {
+        *begin = f->spans[y].begin;
+        *end = f->spans[y].end;
+    } else {
+        *begin = 0;
+        *end = f->dst_width;
+    }
+}
+
+//Row loop shared by the SIMD variants: gather a chunk of taps, then blend/convert
+//it. Convert always produces BGRA, other destinations pack it from a line buffer.
+template <void (*Convert)(const struct fused_taps *, int, uint8_t *),
+          void (*Gather)(const struct fused_frame *, int32_t, int32_t, struct fused_taps *, int) = fused_gather<src_yuyv>,
+          class Dst = dst_bgra>
+static inline void fused_rows_chunked(const struct fused_frame *f, int row_begin, int row_end)
+{
+    struct fused_taps taps;
+    uint8_t line[FUSED_CHUNK * 4];
+    const struct rotate_map *m = &f->map;
+
+    for (int y = row_begin; y < row_end; y++) {
+        int begin, end;
+        fused_row_span(f, y, &begin, &end);
+        int32_t sx = m->xx * begin + m->xy * y + m->x0;
+        int32_t sy = m->yx * begin + m->yy * y + m->y0;
+        uint8_t *out = f->dst + (size_t)y * f->dst_stride;
+
+        for (int x = begin; x < end; x += FUSED_CHUNK) {
+            int n = end - x < FUSED_CHUNK ? end - x : FUSED_CHUNK;
+            for (int i = 0; i < n; i++) {
+                Gather(f, sx, sy, &taps, i);
+                sx += m->xx;
+                sy += m->yx;
+            }
+            if (Dst::bpp == 4) {
+                Convert(&taps, n, out + (size_t)x * 4);
+            } else {
+                Convert(&taps, n, line);
+                Dst::pack(line, n, out + (size_t)x * Dst::bpp);
+            }
+        }
+    }
+}
+
+//Nearest and Q8 bilinear row kernels of one chunk converter for every format
+//pair, indexed [src][dst][QUALITY_NEAREST or QUALITY_Q8]
+struct fused_chunk_rows {
+    rotate_rows_fn rows[SRC_FORMAT_COUNT][DST_FORMAT_COUNT][QUALITY_Q8 + 1];
+};
+
+//Initializer of a fused_chunk_rows table, in rotate_src_format/rotate_dst_format order
+#define FUSED_CHUNK_DST(convert, src, dst) \
+    {fused_rows_chunked<convert, fused_gather_nearest<src>, dst>, fused_rows_chunked<convert, fused_gather<src>, dst>}
+#define FUSED_CHUNK_SRC(convert, src) \
+    {FUSED_CHUNK_DST(convert, src, dst_bgra), FUSED_CHUNK_DST(convert, src, dst_rgb565)}
+#define FUSED_CHUNK_ROWS(convert) \
+    {{FUSED_CHUNK_SRC(convert, src_yuyv), FUSED_CHUNK_SRC(convert, src_uyvy), \
+      FUSED_CHUNK_SRC(convert, src_nv12), FUSED_CHUNK_SRC(convert, src_grey)}}
+
+//SIMD variants, compiled in only on the matching architecture
+#if defined(__aarch64__) || defined(__ARM_NEON)
+extern const struct fused_chunk_rows fused_chunk_rows_neon;
+void yuyv_convert_neon(const uint8_t *src, int pairs, uint8_t *out);
+void lerp_row_neon(const uint8_t *src, int pixels, int weight, uint8_t *out);
+void lerp_columns_neon(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels,
+                       int rows, uint8_t *out, int out_stride);
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct fused_chunk_rows fused_chunk_rows_sse41;
+extern const struct fused_chunk_rows fused_chunk_rows_avx2;
+void yuyv_convert_sse41(const uint8_t *src, int pairs, uint8_t *out);
+void yuyv_convert_avx2(const uint8_t *src, int pairs, uint8_t *out);
+void lerp_row_sse41(const uint8_t *src, int pixels, int weight, uint8_t *out);
+void lerp_row_avx2(const uint8_t *src, int pixels, int weight, uint8_t *out);
+void lerp_columns_sse41(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels,
+                        int rows, uint8_t *out, int out_stride);
+void lerp_columns_avx2(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels,
+                       int rows, uint8_t *out, int out_stride);
+#endif
+
+//Runtime dispatched building blocks for the other CPU engines
+//Straight YUYV -> BGRA conversion of 'pairs' macropixels
+void yuyv_convert(const uint8_t *src, int pairs, uint8_t *out);
+//Sub-pixel shift of a BGRA row: pixel i = src[i] blended with src[i + 1] by
+//'weight' (Q8, 0..255). Reads pixels + 1 source pixels.
+void lerp_row(const uint8_t *src, int pixels, int weight, uint8_t *out);
+//Sub-pixel shift of BGRA columns over 'rows' rows: pixel i of row r = the
+//pixel at src + r * stride + offsets[i] blended with the one a row below by
+//weights[i] (Q8, 0..255). Every column has its own tap row, so the taps are
+//gathered unless neighbouring columns share it. The tap rows must be
+//monotonic in i (as those of a shear): equal ends mean a shared row.
+void lerp_columns(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels, int rows,
+                  uint8_t *out, int out_stride);
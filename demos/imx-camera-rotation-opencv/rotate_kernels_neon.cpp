@@ -0,0 +1,168 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "rotate_kernels_impl.hpp"
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+
+//Q8 bilinear blend of 8 taps, same rounding as fused_blend()
+static inline uint16x8_t blend8(const uint8_t (*p)[FUSED_CHUNK], int i, uint16x8_t wx, uint16x8_t iwx, uint16x8_t wy, uint16x8_t iwy)
+{
+    uint16x8_t top = vmulq_u16(vmovl_u8(vld1_u8(p[0] + i)), iwx);
+    uint16x8_t bot = vmulq_u16(vmovl_u8(vld1_u8(p[2] + i)), iwx);
+    top = vrshrq_n_u16(vmlaq_u16(top, vmovl_u8(vld1_u8(p[1] + i)), wx), 8);
+    bot = vrshrq_n_u16(vmlaq_u16(bot, vmovl_u8(vld1_u8(p[3] + i)), wx), 8);
+    return vrshrq_n_u16(vmlaq_u16(vmulq_u16(top, iwy), bot, wy), 8);
+}
+
+//(yc + cu*u + cv*v) >> 14 for 4 lanes
+static inline int32x4_t channel4(int32x4_t yc, int32x4_t u, int32x4_t v, int32_t cu, int32_t cv)
+{
+    int32x4_t acc = vmlaq_n_s32(yc, u, cu);
+    acc = vmlaq_n_s32(acc, v, cv);
+    return vshrq_n_s32(acc, YUV_SHIFT);
+}
+
+static inline uint8x8_t narrow8(int32x4_t lo, int32x4_t hi)
+{
+    return vqmovn_u16(vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi)));
+}
+
+//Convert 8 pixels, y/u/v hold 8 bit values in 16 bit lanes
+static inline uint8x8x4_t yuv_to_bgra8(uint16x8_t y16, uint16x8_t u16, uint16x8_t v16)
+{
+    const int16x8_t k128 = vdupq_n_s16(128);
+    uint16x8_t y = vqsubq_u16(y16, vdupq_n_u16(16));
+    int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(u16), k128);
+    int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(v16), k128);
+
+    int32x4_t yc_lo = vmlaq_n_s32(vdupq_n_s32(YUV_ROUND), vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y))), YUV_CY);
+    int32x4_t yc_hi = vmlaq_n_s32(vdupq_n_s32(YUV_ROUND), vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y))), YUV_CY);
+    int32x4_t u_lo = vmovl_s16(vget_low_s16(u));
+    int32x4_t u_hi = vmovl_s16(vget_high_s16(u));
+    int32x4_t v_lo = vmovl_s16(vget_low_s16(v));
+    int32x4_t v_hi = vmovl_s16(vget_high_s16(v));
+
+    uint8x8x4_t bgra;
+    bgra.val[0] = narrow8(channel4(yc_lo, u_lo, v_lo, YUV_CUB, 0), channel4(yc_hi, u_hi, v_hi, YUV_CUB, 0));
+    bgra.val[1] = narrow8(channel4(yc_lo, u_lo, v_lo, YUV_CUG, YUV_CVG), channel4(yc_hi, u_hi, v_hi, YUV_CUG, YUV_CVG));
+    bgra.val[2] = narrow8(channel4(yc_lo, u_lo, v_lo, 0, YUV_CVR), channel4(yc_hi, u_hi, v_hi, 0, YUV_CVR));
+    bgra.val[3] = vdup_n_u8(0xff);
+    return bgra;
+}
+
+static void convert_chunk_neon(const struct fused_taps *t, int n, uint8_t *out)
+{
+    const uint16x8_t k256 = vdupq_n_u16(256);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t wx = vld1q_u16(t->wx + i);
+        uint16x8_t wy = vld1q_u16(t->wy + i);
+        uint16x8_t iwx = vsubq_u16(k256, wx);
+        uint16x8_t iwy = vsubq_u16(k256, wy);
+
+        vst4_u8(out + i * 4, yuv_to_bgra8(blend8(t->y, i, wx, iwx, wy, iwy),
+                                          blend8(t->u, i, wx, iwx, wy, iwy),
+                                          blend8(t->v, i, wx, iwx, wy, iwy)));
+    }
+    fused_convert_scalar(t, i, n, out);
+}
+
+const struct fused_chunk_rows fused_chunk_rows_neon = FUSED_CHUNK_ROWS(convert_chunk_neon);
+
+void yuyv_convert_neon(const uint8_t *src, int pairs, uint8_t *out)
+{
+    int i = 0;
+
+    for (; i + 8 <= pairs; i += 8) {
+        //De-interleave 8 macropixels into Y0, U, Y1, V
+        uint8x8x4_t p = vld4_u8(src + i * 4);
+        uint16x8_t u = vmovl_u8(p.val[1]);
+        uint16x8_t v = vmovl_u8(p.val[3]);
+        uint8x8x4_t even = yuv_to_bgra8(vmovl_u8(p.val[0]), u, v);
+        uint8x8x4_t odd = yuv_to_bgra8(vmovl_u8(p.val[2]), u, v);
+
+        //Re-interleave even/odd pixels and store 16 BGRA pixels
+        uint8x16x4_t bgra;
+        for (int c = 0; c < 3; c++) {
+            uint8x8x2_t z = vzip_u8(even.val[c], odd.val[c]);
+            bgra.val[c] = vcombine_u8(z.val[0], z.val[1]);
+        }
+        bgra.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(out + i * 8, bgra);
+    }
+    yuyv_convert_scalar(src, i, pairs, out);
+}
+
+void lerp_row_neon(const uint8_t *src, int pixels, int weight, uint8_t *out)
+{
+    const uint8x8_t w = vdup_n_u8((uint8_t)weight);
+    const uint8x8_t iw = vdup_n_u8((uint8_t)(256 - weight));
+    int n = pixels * 4;
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t a = vld1q_u8(src + i);
+        uint8x16_t b = vld1q_u8(src + i + 4);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), iw), vget_low_u8(b), w);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a), iw), vget_high_u8(b), w);
+        vst1q_u8(out + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+    lerp_bytes_scalar(src, i, n, weight, out);
+}
+
+//Two pixels of per pixel weights, one 16 bit lane per byte
+static inline uint16x8_t column_weights_neon(const uint8_t *w)
+{
+    return vcombine_u16(vdup_n_u16(w[0]), vdup_n_u16(w[1]));
+}
+
+void lerp_columns_neon(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels,
+                       int rows, uint8_t *out, int out_stride)
+{
+    const uint16x8_t k256 = vdupq_n_u16(256);
+    int i = 0;
+
+    //Four columns down every row, their weights and layout stay the same
+    for (; i + 4 <= pixels; i += 4) {
+        const int32_t *o = offsets + i;
+        uint16x8_t wlo = column_weights_neon(weights + i);
+        uint16x8_t whi = column_weights_neon(weights + i + 2);
+        uint16x8_t iwlo = vsubq_u16(k256, wlo);
+        uint16x8_t iwhi = vsubq_u16(k256, whi);
+        bool shared = o[3] - o[0] == 12;
+
+        for (int r = 0; r < rows; r++) {
+            const uint8_t *row = src + (size_t)r * stride;
+            uint8x16_t a8, b8;
+            if (shared) {
+                a8 = vld1q_u8(row + o[0]);
+                b8 = vld1q_u8(row + o[0] + stride);
+            } else {
+                uint32x4_t a = vdupq_n_u32(0);
+                uint32x4_t b = vdupq_n_u32(0);
+                a = vld1q_lane_u32((const uint32_t *)(row + o[0]), a, 0);
+                a = vld1q_lane_u32((const uint32_t *)(row + o[1]), a, 1);
+                a = vld1q_lane_u32((const uint32_t *)(row + o[2]), a, 2);
+                a = vld1q_lane_u32((const uint32_t *)(row + o[3]), a, 3);
+                b = vld1q_lane_u32((const uint32_t *)(row + o[0] + stride), b, 0);
+                b = vld1q_lane_u32((const uint32_t *)(row + o[1] + stride), b, 1);
+                b = vld1q_lane_u32((const uint32_t *)(row + o[2] + stride), b, 2);
+                b = vld1q_lane_u32((const uint32_t *)(row + o[3] + stride), b, 3);
+                a8 = vreinterpretq_u8_u32(a);
+                b8 = vreinterpretq_u8_u32(b);
+            }
+            uint16x8_t lo = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(a8)), iwlo), vmovl_u8(vget_low_u8(b8)), wlo);
+            uint16x8_t hi = vmlaq_u16(vmulq_u16(vmovl_u8(vget_high_u8(a8)), iwhi), vmovl_u8(vget_high_u8(b8)), whi);
+            vst1q_u8(out + (size_t)r * out_stride + i * 4, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+        }
+    }
+    lerp_columns_scalar(src, stride, offsets, weights, i, pixels, rows, out, out_stride);
+}
+
+#endif
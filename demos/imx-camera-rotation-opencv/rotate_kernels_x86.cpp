@@ -0,0 +1,351 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "rotate_kernels_impl.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+//Both variants are built with function level target attributes so the
+//binary still runs on CPUs without them; selection happens at runtime.
+
+/************************ SSE4.1 ******************************/
+#define SSE41 __attribute__((target("sse4.1")))
+
+SSE41 static inline __m128i load8_sse41(const uint8_t *p)
+{
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)p));
+}
+
+SSE41 static inline __m128i blend8_sse41(const uint8_t (*p)[FUSED_CHUNK], int i, __m128i wx, __m128i iwx, __m128i wy, __m128i iwy)
+{
+    const __m128i k128 = _mm_set1_epi16(128);
+    __m128i top = _mm_add_epi16(_mm_mullo_epi16(load8_sse41(p[0] + i), iwx), _mm_mullo_epi16(load8_sse41(p[1] + i), wx));
+    __m128i bot = _mm_add_epi16(_mm_mullo_epi16(load8_sse41(p[2] + i), iwx), _mm_mullo_epi16(load8_sse41(p[3] + i), wx));
+    top = _mm_srli_epi16(_mm_add_epi16(top, k128), 8);
+    bot = _mm_srli_epi16(_mm_add_epi16(bot, k128), 8);
+    __m128i acc = _mm_add_epi16(_mm_mullo_epi16(top, iwy), _mm_mullo_epi16(bot, wy));
+    return _mm_srli_epi16(_mm_add_epi16(acc, k128), 8);
+}
+
+SSE41 static inline __m128i channel4_sse41(__m128i yc, __m128i u, __m128i v, int32_t cu, int32_t cv)
+{
+    __m128i acc = _mm_add_epi32(yc, _mm_mullo_epi32(u, _mm_set1_epi32(cu)));
+    acc = _mm_add_epi32(acc, _mm_mullo_epi32(v, _mm_set1_epi32(cv)));
+    return _mm_srai_epi32(acc, YUV_SHIFT);
+}
+
+//8 lanes of int32 (lo, hi) -> 8 saturated bytes in the low half
+SSE41 static inline __m128i narrow8_sse41(__m128i lo, __m128i hi)
+{
+    __m128i s16 = _mm_packs_epi32(lo, hi);
+    return _mm_packus_epi16(s16, s16);
+}
+
+SSE41 static inline void store_bgra8_sse41(__m128i b, __m128i g, __m128i r, uint8_t *out)
+{
+    __m128i bg = _mm_unpacklo_epi8(b, g);
+    __m128i ra = _mm_unpacklo_epi8(r, _mm_set1_epi8((char)0xff));
+    _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi16(bg, ra));
+}
+
+//Convert 8 pixels whose Y (already minus 16)/U/V sit in 16 bit lanes
+SSE41 static inline void convert8_sse41(__m128i y, __m128i u, __m128i v, uint8_t *out)
+{
+    const __m128i k128 = _mm_set1_epi32(128);
+    const __m128i kround = _mm_set1_epi32(YUV_ROUND);
+    const __m128i kcy = _mm_set1_epi32(YUV_CY);
+
+    __m128i yc_lo = _mm_add_epi32(_mm_mullo_epi32(_mm_cvtepu16_epi32(y), kcy), kround);
+    __m128i yc_hi = _mm_add_epi32(_mm_mullo_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(y, 8)), kcy), kround);
+    __m128i u_lo = _mm_sub_epi32(_mm_cvtepu16_epi32(u), k128);
+    __m128i u_hi = _mm_sub_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(u, 8)), k128);
+    __m128i v_lo = _mm_sub_epi32(_mm_cvtepu16_epi32(v), k128);
+    __m128i v_hi = _mm_sub_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)), k128);
+
+    __m128i b = narrow8_sse41(channel4_sse41(yc_lo, u_lo, v_lo, YUV_CUB, 0), channel4_sse41(yc_hi, u_hi, v_hi, YUV_CUB, 0));
+    __m128i g = narrow8_sse41(channel4_sse41(yc_lo, u_lo, v_lo, YUV_CUG, YUV_CVG), channel4_sse41(yc_hi, u_hi, v_hi, YUV_CUG, YUV_CVG));
+    __m128i r = narrow8_sse41(channel4_sse41(yc_lo, u_lo, v_lo, 0, YUV_CVR), channel4_sse41(yc_hi, u_hi, v_hi, 0, YUV_CVR));
+    store_bgra8_sse41(b, g, r, out);
+}
+
+SSE41 static void convert_chunk_sse41(const struct fused_taps *t, int n, uint8_t *out)
+{
+    const __m128i k256 = _mm_set1_epi16(256);
+    const __m128i k16 = _mm_set1_epi16(16);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i wx = _mm_loadu_si128((const __m128i *)(t->wx + i));
+        __m128i wy = _mm_loadu_si128((const __m128i *)(t->wy + i));
+        __m128i iwx = _mm_sub_epi16(k256, wx);
+        __m128i iwy = _mm_sub_epi16(k256, wy);
+
+        convert8_sse41(_mm_subs_epu16(blend8_sse41(t->y, i, wx, iwx, wy, iwy), k16),
+                       blend8_sse41(t->u, i, wx, iwx, wy, iwy),
+                       blend8_sse41(t->v, i, wx, iwx, wy, iwy),
+                       out + i * 4);
+    }
+    fused_convert_scalar(t, i, n, out);
+}
+
+const struct fused_chunk_rows fused_chunk_rows_sse41 = FUSED_CHUNK_ROWS(convert_chunk_sse41);
+
+//Byte shuffles splitting 4 YUYV macropixels into 8 zero extended Y, U and V
+//lanes (chroma duplicated for both pixels of a macropixel)
+#define YUYV_SHUF_Y 0, -1, 2, -1, 4, -1, 6, -1, 8, -1, 10, -1, 12, -1, 14, -1
+#define YUYV_SHUF_U 1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1
+#define YUYV_SHUF_V 3, -1, 3, -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1
+
+SSE41 void yuyv_convert_sse41(const uint8_t *src, int pairs, uint8_t *out)
+{
+    const __m128i ky = _mm_setr_epi8(YUYV_SHUF_Y);
+    const __m128i ku = _mm_setr_epi8(YUYV_SHUF_U);
+    const __m128i kv = _mm_setr_epi8(YUYV_SHUF_V);
+    const __m128i k16 = _mm_set1_epi16(16);
+    int i = 0;
+
+    for (; i + 4 <= pairs; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        convert8_sse41(_mm_subs_epu16(_mm_shuffle_epi8(p, ky), k16), _mm_shuffle_epi8(p, ku), _mm_shuffle_epi8(p, kv), out + i * 8);
+    }
+    yuyv_convert_scalar(src, i, pairs, out);
+}
+
+SSE41 void lerp_row_sse41(const uint8_t *src, int pixels, int weight, uint8_t *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_set1_epi16((short)weight);
+    const __m128i iw = _mm_set1_epi16((short)(256 - weight));
+    const __m128i k128 = _mm_set1_epi16(128);
+    int n = pixels * 4;
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), iw), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), iw), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, k128), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, k128), 8);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+    lerp_bytes_scalar(src, i, n, weight, out);
+}
+
+static inline uint32_t load32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+SSE41 void lerp_columns_sse41(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels,
+                              int rows, uint8_t *out, int out_stride)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i k256 = _mm_set1_epi16(256);
+    int i = 0;
+
+    //Four columns down every row, their weights and layout stay the same
+    for (; i + 4 <= pixels; i += 4) {
+        const int32_t *o = offsets + i;
+        const uint8_t *w = weights + i;
+        __m128i wlo = _mm_setr_epi16(w[0], w[0], w[0], w[0], w[1], w[1], w[1], w[1]);
+        __m128i whi = _mm_setr_epi16(w[2], w[2], w[2], w[2], w[3], w[3], w[3], w[3]);
+        __m128i iwlo = _mm_sub_epi16(k256, wlo);
+        __m128i iwhi = _mm_sub_epi16(k256, whi);
+        bool shared = o[3] - o[0] == 12;
+
+        for (int r = 0; r < rows; r++) {
+            const uint8_t *row = src + (size_t)r * stride;
+            __m128i a, b;
+            if (shared) {
+                a = _mm_loadu_si128((const __m128i *)(row + o[0]));
+                b = _mm_loadu_si128((const __m128i *)(row + o[0] + stride));
+            } else {
+                a = _mm_setr_epi32((int)load32(row + o[0]), (int)load32(row + o[1]), (int)load32(row + o[2]),
+                                   (int)load32(row + o[3]));
+                b = _mm_setr_epi32((int)load32(row + o[0] + stride), (int)load32(row + o[1] + stride),
+                                   (int)load32(row + o[2] + stride), (int)load32(row + o[3] + stride));
+            }
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), iwlo),
+                                       _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wlo));
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), iwhi),
+                                       _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), whi));
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, k128), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, k128), 8);
+            _mm_storeu_si128((__m128i *)(out + (size_t)r * out_stride + i * 4), _mm_packus_epi16(lo, hi));
+        }
+    }
+    lerp_columns_scalar(src, stride, offsets, weights, i, pixels, rows, out, out_stride);
+}
+
+/************************ AVX2 ******************************/
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i load16_avx2(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+AVX2 static inline __m256i blend16_avx2(const uint8_t (*p)[FUSED_CHUNK], int i, __m256i wx, __m256i iwx, __m256i wy, __m256i iwy)
+{
+    const __m256i k128 = _mm256_set1_epi16(128);
+    __m256i top = _mm256_add_epi16(_mm256_mullo_epi16(load16_avx2(p[0] + i), iwx), _mm256_mullo_epi16(load16_avx2(p[1] + i), wx));
+    __m256i bot = _mm256_add_epi16(_mm256_mullo_epi16(load16_avx2(p[2] + i), iwx), _mm256_mullo_epi16(load16_avx2(p[3] + i), wx));
+    top = _mm256_srli_epi16(_mm256_add_epi16(top, k128), 8);
+    bot = _mm256_srli_epi16(_mm256_add_epi16(bot, k128), 8);
+    __m256i acc = _mm256_add_epi16(_mm256_mullo_epi16(top, iwy), _mm256_mullo_epi16(bot, wy));
+    return _mm256_srli_epi16(_mm256_add_epi16(acc, k128), 8);
+}
+
+AVX2 static inline __m256i channel8_avx2(__m256i yc, __m256i u, __m256i v, int32_t cu, int32_t cv)
+{
+    __m256i acc = _mm256_add_epi32(yc, _mm256_mullo_epi32(u, _mm256_set1_epi32(cu)));
+    acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v, _mm256_set1_epi32(cv)));
+    return _mm256_srai_epi32(acc, YUV_SHIFT);
+}
+
+//8 lanes of int32 -> 8 saturated bytes in the low half of an SSE register
+AVX2 static inline __m128i narrow8_avx2(__m256i v)
+{
+    __m128i s16 = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_packus_epi16(s16, s16);
+}
+
+//Convert 8 pixels whose blended Y/U/V sit in the low 8 lanes of 16 bit registers
+AVX2 static inline void convert8_avx2(__m128i y, __m128i u, __m128i v, uint8_t *out)
+{
+    const __m256i k128 = _mm256_set1_epi32(128);
+    __m256i yc = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvtepu16_epi32(y), _mm256_set1_epi32(YUV_CY)), _mm256_set1_epi32(YUV_ROUND));
+    __m256i u32 = _mm256_sub_epi32(_mm256_cvtepu16_epi32(u), k128);
+    __m256i v32 = _mm256_sub_epi32(_mm256_cvtepu16_epi32(v), k128);
+
+    __m128i b = narrow8_avx2(channel8_avx2(yc, u32, v32, YUV_CUB, 0));
+    __m128i g = narrow8_avx2(channel8_avx2(yc, u32, v32, YUV_CUG, YUV_CVG));
+    __m128i r = narrow8_avx2(channel8_avx2(yc, u32, v32, 0, YUV_CVR));
+    __m128i bg = _mm_unpacklo_epi8(b, g);
+    __m128i ra = _mm_unpacklo_epi8(r, _mm_set1_epi8((char)0xff));
+    _mm256_storeu_si256((__m256i *)out, _mm256_set_m128i(_mm_unpackhi_epi16(bg, ra), _mm_unpacklo_epi16(bg, ra)));
+}
+
+AVX2 static void convert_chunk_avx2(const struct fused_taps *t, int n, uint8_t *out)
+{
+    const __m256i k256 = _mm256_set1_epi16(256);
+    const __m256i k16 = _mm256_set1_epi16(16);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i wx = _mm256_loadu_si256((const __m256i *)(t->wx + i));
+        __m256i wy = _mm256_loadu_si256((const __m256i *)(t->wy + i));
+        __m256i iwx = _mm256_sub_epi16(k256, wx);
+        __m256i iwy = _mm256_sub_epi16(k256, wy);
+
+        __m256i y = _mm256_subs_epu16(blend16_avx2(t->y, i, wx, iwx, wy, iwy), k16);
+        __m256i u = blend16_avx2(t->u, i, wx, iwx, wy, iwy);
+        __m256i v = blend16_avx2(t->v, i, wx, iwx, wy, iwy);
+
+        convert8_avx2(_mm256_castsi256_si128(y), _mm256_castsi256_si128(u), _mm256_castsi256_si128(v), out + i * 4);
+        convert8_avx2(_mm256_extracti128_si256(y, 1), _mm256_extracti128_si256(u, 1), _mm256_extracti128_si256(v, 1), out + (i + 8) * 4);
+    }
+    fused_convert_scalar(t, i, n, out);
+}
+
+const struct fused_chunk_rows fused_chunk_rows_avx2 = FUSED_CHUNK_ROWS(convert_chunk_avx2);
+
+AVX2 void yuyv_convert_avx2(const uint8_t *src, int pairs, uint8_t *out)
+{
+    //vpshufb works per 128 bit lane, each lane holds 4 macropixels
+    const __m256i ky = _mm256_setr_epi8(YUYV_SHUF_Y, YUYV_SHUF_Y);
+    const __m256i ku = _mm256_setr_epi8(YUYV_SHUF_U, YUYV_SHUF_U);
+    const __m256i kv = _mm256_setr_epi8(YUYV_SHUF_V, YUYV_SHUF_V);
+    const __m256i k16 = _mm256_set1_epi16(16);
+    int i = 0;
+
+    for (; i + 8 <= pairs; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+        __m256i y = _mm256_subs_epu16(_mm256_shuffle_epi8(p, ky), k16);
+        __m256i u = _mm256_shuffle_epi8(p, ku);
+        __m256i v = _mm256_shuffle_epi8(p, kv);
+
+        convert8_avx2(_mm256_castsi256_si128(y), _mm256_castsi256_si128(u), _mm256_castsi256_si128(v), out + i * 8);
+        convert8_avx2(_mm256_extracti128_si256(y, 1), _mm256_extracti128_si256(u, 1), _mm256_extracti128_si256(v, 1), out + i * 8 + 32);
+    }
+    yuyv_convert_scalar(src, i, pairs, out);
+}
+
+AVX2 void lerp_row_avx2(const uint8_t *src, int pixels, int weight, uint8_t *out)
+{
+    //Unpack and pack both work per 128 bit lane, so the byte order is preserved
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i w = _mm256_set1_epi16((short)weight);
+    const __m256i iw = _mm256_set1_epi16((short)(256 - weight));
+    const __m256i k128 = _mm256_set1_epi16(128);
+    int n = pixels * 4;
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i + 4));
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), iw), _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), w));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), iw), _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), w));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, k128), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, k128), 8);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_packus_epi16(lo, hi));
+    }
+    lerp_bytes_scalar(src, i, n, weight, out);
+}
+
+AVX2 void lerp_columns_avx2(const uint8_t *src, int stride, const int32_t *offsets, const uint8_t *weights, int pixels,
+                            int rows, uint8_t *out, int out_stride)
+{
+    //Eight columns down every row. The taps are gathered unless the columns
+    //share a row, unpacking per 128 bit lane puts pixels 0, 1, 4, 5 in the
+    //low halves and 2, 3, 6, 7 in the high ones.
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m256i k256 = _mm256_set1_epi16(256);
+    const __m256i below = _mm256_set1_epi32(stride);
+    int i = 0;
+
+    for (; i + 8 <= pixels; i += 8) {
+        const uint8_t *w = weights + i;
+        __m256i o = _mm256_loadu_si256((const __m256i *)(offsets + i));
+        __m256i ob = _mm256_add_epi32(o, below);
+        __m256i wlo = _mm256_setr_epi16(w[0], w[0], w[0], w[0], w[1], w[1], w[1], w[1],
+                                        w[4], w[4], w[4], w[4], w[5], w[5], w[5], w[5]);
+        __m256i whi = _mm256_setr_epi16(w[2], w[2], w[2], w[2], w[3], w[3], w[3], w[3],
+                                        w[6], w[6], w[6], w[6], w[7], w[7], w[7], w[7]);
+        __m256i iwlo = _mm256_sub_epi16(k256, wlo);
+        __m256i iwhi = _mm256_sub_epi16(k256, whi);
+        bool shared = offsets[i + 7] - offsets[i] == 28;
+
+        for (int r = 0; r < rows; r++) {
+            const uint8_t *row = src + (size_t)r * stride;
+            __m256i a, b;
+            if (shared) {
+                a = _mm256_loadu_si256((const __m256i *)(row + offsets[i]));
+                b = _mm256_loadu_si256((const __m256i *)(row + offsets[i] + stride));
+            } else {
+                a = _mm256_i32gather_epi32((const int *)row, o, 1);
+                b = _mm256_i32gather_epi32((const int *)row, ob, 1);
+            }
+            __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), iwlo),
+                                          _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), wlo));
+            __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), iwhi),
+                                          _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), whi));
+            lo = _mm256_srli_epi16(_mm256_add_epi16(lo, k128), 8);
+            hi = _mm256_srli_epi16(_mm256_add_epi16(hi, k128), 8);
+            _mm256_storeu_si256((__m256i *)(out + (size_t)r * out_stride + i * 4), _mm256_packus_epi16(lo, hi));
+        }
+    }
+    lerp_columns_scalar(src, stride, offsets, weights, i, pixels, rows, out, out_stride);
+}
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <limits.h>
+#include "rotation_plan.hpp"
+
+using namespace cv;
+
+RotationPlanCache::RotationPlanCache(size_t max_bytes, enum rotate_engine engine, enum rotate_quality quality)
+    : m_max_bytes(max_bytes),
+      m_bytes(0),
+      m_engine(engine),
+      m_quality(quality),
+      m_stop(false)
+{
+    m_builder = std::thread(&RotationPlanCache::builder_loop, this);
+}
+
+RotationPlanCache::~RotationPlanCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_builder.join();
+}
+
+int RotationPlanCache::normalize_angle(int angle)
+{
+    angle %= 360;
+    return angle < 0 ? angle + 360 : angle;
+}
+
+//Bounding box of the non-empty spans
+static Rect spans_bounds(const std::vector<struct rotate_span> &spans)
+{
+    int x0 = INT_MAX, x1 = 0, y0 = INT_MAX, y1 = 0;
+    for (size_t y = 0; y < spans.size(); y++) {
+        if (spans[y].begin < spans[y].end) {
+            x0 = spans[y].begin < x0 ? spans[y].begin : x0;
+            x1 = spans[y].end > x1 ? spans[y].end : x1;
+            y0 = (int)y < y0 ? (int)y : y0;
+            y1 = (int)y + 1;
+        }
+    }
+    return x0 < x1 ? Rect(x0, y0, x1 - x0, y1 - y0) : Rect();
+}
+
+rotation_plan_ptr RotationPlanCache::build(int w, int h, int angle) const
+{
+    std::shared_ptr<rotation_plan> plan = std::make_shared<rotation_plan>();
+    plan->width = w;
+    plan->height = h;
+    plan->angle = angle;
+    rotate_map_init(&plan->map, w, h, angle);
+    plan->bytes = sizeof(rotation_plan);
+    if (m_engine == ENGINE_SHEAR) {
+        shear_plan_init(&plan->shear, w, h, angle, m_quality == QUALITY_NEAREST);
+        plan->bytes += (plan->shear.shift1.size() + plan->shear.shift2.size() + plan->shear.shift3.size()) * sizeof(int32_t);
+        return plan;
+    }
+
+    //Only the footprint is resampled. cv::remap rounds the map to 1/32 pixel
+    //on its own, one pixel of margin keeps its edge pixels in the spans.
+    plan->spans.resize(h);
+    rotate_spans_init(plan->spans.data(), &plan->map, w, h, w, h, m_quality == QUALITY_NEAREST,
+                      m_engine == ENGINE_OPENCV ? 1 : 0);
+    plan->bytes += plan->spans.size() * sizeof(struct rotate_span);
+    plan->footprint = spans_bounds(plan->spans);
+    if (m_engine != ENGINE_OPENCV) {
+        return plan;
+    }
+
+    //Same inverse mapping as warpAffine(getRotationMatrix2D(...)), in float,
+    //then packed into the fixed point format remap() consumes directly
+    Mat mapx(h, w, CV_32FC1);
+    Mat mapy(h, w, CV_32FC1);
+    const double scale = 1.0 / 65536.0;
+    for (int y = 0; y < h; y++) {
+        float *px = mapx.ptr<float>(y);
+        float *py = mapy.ptr<float>(y);
+        double sx = ((double)plan->map.xy * y + plan->map.x0) * scale;
+        double sy = ((double)plan->map.yy * y + plan->map.y0) * scale;
+        for (int x = 0; x < w; x++) {
+            px[x] = (float)(sx + plan->map.xx * scale * x);
+            py[x] = (float)(sy + plan->map.yx * scale * x);
+        }
+    }
+    convertMaps(mapx, mapy, plan->map1, plan->map2, CV_16SC2, m_quality == QUALITY_NEAREST);
+    plan->bytes += plan->map1.total() * plan->map1.elemSize() + plan->map2.total() * plan->map2.elemSize();
+    return plan;
+}
+
+rotation_plan_ptr RotationPlanCache::lookup_locked(int w, int h, int angle)
+{
+    for (auto it = m_plans.begin(); it != m_plans.end(); ++it) {
+        if ((*it)->width == w && (*it)->height == h && (*it)->angle == angle) {
+            //Move to front (most recently used)
+            m_plans.splice(m_plans.begin(), m_plans, it);
+            return m_plans.front();
+        }
+    }
+    return nullptr;
+}
+
+void RotationPlanCache::insert_locked(const rotation_plan_ptr &plan)
+{
+    if (lookup_locked(plan->width, plan->height, plan->angle)) {
+        return;
+    }
+    m_plans.push_front(plan);
+    m_bytes += plan->bytes;
+
+    //Evict least recently used plans, always keeping the newest one
+    while (m_bytes > m_max_bytes && m_plans.size() > 1) {
+        m_bytes -= m_plans.back()->bytes;
+        m_plans.pop_back();
+    }
+}
+
+bool RotationPlanCache::queued_locked(int w, int h, int angle) const
+{
+    for (const request &r : m_queue) {
+        if (r.width == w && r.height == h && r.angle == angle) {
+            return true;
+        }
+    }
+    return false;
+}
+
+rotation_plan_ptr RotationPlanCache::get(int w, int h, int angle, const rotation_plan_ptr &current)
+{
+    angle = normalize_angle(angle);
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    rotation_plan_ptr plan = lookup_locked(w, h, angle);
+    if (plan) {
+        return plan;
+    }
+
+    //Not ready yet: schedule it and keep using the caller's plan
+    if (current && current->width == w && current->height == h) {
+        if (!queued_locked(w, h, angle)) {
+            m_queue.push_back({w, h, angle});
+            m_cond.notify_one();
+        }
+        return current;
+    }
+
+    //Nothing usable (first frame): build synchronously
+    lock.unlock();
+    plan = build(w, h, angle);
+    lock.lock();
+    insert_locked(plan);
+    return plan;
+}
+
+void RotationPlanCache::prefetch(int w, int h, int angle)
+{
+    angle = normalize_angle(angle);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const rotation_plan_ptr &p : m_plans) {
+        if (p->width == w && p->height == h && p->angle == angle) {
+            return;
+        }
+    }
+    if (!queued_locked(w, h, angle)) {
+        m_queue.push_back({w, h, angle});
+        m_cond.notify_one();
+    }
+}
+
+void RotationPlanCache::builder_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        if (m_queue.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        //Only the newest request matters, older angles are already stale
+        request r = m_queue.back();
+        m_queue.clear();
+        if (lookup_locked(r.width, r.height, r.angle)) {
+            continue;
+        }
+
+        lock.unlock();
+        rotation_plan_ptr plan = build(r.width, r.height, r.angle);
+        lock.lock();
+        insert_locked(plan);
+    }
+}
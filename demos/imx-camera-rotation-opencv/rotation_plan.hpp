@@ -0,0 +1,77 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "rotate_kernels.hpp"
+#include "shear_rotate.hpp"
+
+//Everything that depends only on (width, height, angle), computed once
+struct rotation_plan {
+    int width;
+    int height;
+    int angle;                  //Normalized to [0, 360)
+    struct rotate_map map;      //Q16 inverse map for the fused kernel
+    cv::Mat map1;               //cv::remap fixed point maps (CV_16SC2)
+    cv::Mat map2;               //cv::remap interpolation table indices (CV_16UC1), empty for nearest
+    struct shear_plan shear;    //Shift tables of the shear engine
+    std::vector<struct rotate_span> spans;  //Source footprint per output row (all engines but shear)
+    cv::Rect footprint;         //Bounding box of the spans, the only pixels a frame changes
+    size_t bytes;               //Memory held by the plan (LRU accounting)
+};
+
+typedef std::shared_ptr<const rotation_plan> rotation_plan_ptr;
+
+//LRU cache of rotation plans with a background builder thread.
+//The frame loop only calls get(); a new angle is built off the hot path and
+//the caller's previous plan is used until it is ready.
+class RotationPlanCache {
+public:
+    //Only the tables used by 'engine' at 'quality' are built
+    RotationPlanCache(size_t max_bytes, enum rotate_engine engine, enum rotate_quality quality);
+    ~RotationPlanCache();
+
+    //Plan for (w, h, angle). While it builds, 'current' (the plan the caller
+    //used last) is returned if it has the same size, so callers at different
+    //angles never get each other's plan. Without one, it is built at once.
+    rotation_plan_ptr get(int w, int h, int angle, const rotation_plan_ptr &current = rotation_plan_ptr());
+
+    //Queue a background build, e.g. as soon as a new angle is received
+    void prefetch(int w, int h, int angle);
+
+    static int normalize_angle(int angle);
+
+private:
+    struct request {
+        int width;
+        int height;
+        int angle;
+    };
+
+    rotation_plan_ptr build(int w, int h, int angle) const;
+    rotation_plan_ptr lookup_locked(int w, int h, int angle);
+    void insert_locked(const rotation_plan_ptr &plan);
+    bool queued_locked(int w, int h, int angle) const;
+    void builder_loop();
+
+    size_t m_max_bytes;
+    size_t m_bytes;
+    enum rotate_engine m_engine;
+    enum rotate_quality m_quality;
+    bool m_stop;
+    std::list<rotation_plan_ptr> m_plans;   //Most recently used first
+    std::vector<request> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_builder;
+};
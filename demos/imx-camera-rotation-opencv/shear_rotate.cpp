@@ -0,0 +1,205 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <math.h>
+#include "rotate_kernels_impl.hpp"
+#include "shear_rotate.hpp"
+
+//Columns per strip of the vertical pass: one 64 byte cache line of BGRA
+#define SHEAR_STRIP 16
+//Opaque black as a little endian BGRA word
+#define SHEAR_BG 0xff000000u
+
+static int32_t to_q8(double v, bool nearest)
+{
+    return nearest ? (int32_t)lround(v) * 256 : (int32_t)lround(v * 256.0);
+}
+
+int shear_max_width(int w, int h)
+{
+    //|t| <= 1 once the angle is folded into [-90, 90]
+    int m = h / 2 > h - 1 - h / 2 ? h / 2 : h - 1 - h / 2;
+    return w + 2 * m + 3;
+}
+
+void shear_plan_init(struct shear_plan *plan, int w, int h, int angle, bool nearest)
+{
+    //Inverse rotation angle, as in rotate_map_init(), folded into (-180, 180]
+    int deg = 360 - (angle % 360);
+    deg %= 360;
+    if (deg > 180) {
+        deg -= 360;
+    } else if (deg <= -180) {
+        deg += 360;
+    }
+    plan->flip = deg > 90 || deg < -90;
+    if (plan->flip) {
+        deg += deg > 0 ? -180 : 180;
+    }
+
+    double theta = deg * M_PI / 180.0;
+    double t = -tan(theta / 2);
+    double s = sin(theta);
+    int cx = w / 2;
+    int cy = h / 2;
+    int m = cy > h - 1 - cy ? cy : h - 1 - cy;
+
+    //Intermediate column c is x = c + xmin in coordinates centered on (cx, cy)
+    int xmin = (int)floor(-cx - fabs(t) * m) - 1;
+    plan->width = w + (int)ceil(2 * fabs(t) * m) + 3;
+
+    //Flipped, tmp1 holds the source upside down and every row reversed:
+    //index 0 is at x = 2*cx - (w - 1), y = 2*cy - (h - 1)
+    int ox = plan->flip ? 2 * cx - (w - 1) : 0;
+    int oy = plan->flip ? 2 * cy - (h - 1) : 0;
+
+    plan->shift1.resize(h);
+    plan->shift2.resize(plan->width);
+    plan->shift3.resize(h);
+    for (int r = 0; r < h; r++) {
+        plan->shift1[r] = to_q8(xmin + cx + t * (r + oy - cy) - ox, nearest);
+    }
+    for (int c = 0; c < plan->width; c++) {
+        plan->shift2[c] = to_q8(s * (c + xmin) - oy, nearest);
+    }
+
+    //Column c reads tmp1 rows y + i and y + i + 1, both inside for y in [-i, h - 1 - i)
+    int strips = (plan->width + SHEAR_STRIP - 1) / SHEAR_STRIP;
+    plan->rows2.resize(strips * 2);
+    for (int k = 0; k < strips; k++) {
+        int lo = 0;
+        int hi = h;
+        for (int c = k * SHEAR_STRIP; c < plan->width && c < (k + 1) * SHEAR_STRIP; c++) {
+            int i = plan->shift2[c] >> 8;
+            lo = -i > lo ? -i : lo;
+            hi = h - 1 - i < hi ? h - 1 - i : hi;
+        }
+        plan->rows2[k * 2] = lo;
+        plan->rows2[k * 2 + 1] = hi > lo ? hi : lo;
+    }
+    for (int y = 0; y < h; y++) {
+        plan->shift3[y] = to_q8(t * (y - cy) - cx - xmin, nearest);
+    }
+}
+
+//Q8 blend of two BGRA pixels, two channels per multiply (same rounding as lerp_row)
+static inline uint32_t lerp_bgra(uint32_t p, uint32_t q, uint32_t w)
+{
+    uint32_t iw = 256 - w;
+    uint32_t rb = ((((p & 0x00ff00ff) * iw + (q & 0x00ff00ff) * w + 0x00800080) >> 8) & 0x00ff00ff);
+    uint32_t ga = ((((p >> 8) & 0x00ff00ff) * iw + ((q >> 8) & 0x00ff00ff) * w + 0x00800080) & 0xff00ff00);
+    return rb | ga;
+}
+
+//Blend of line[k] and line[k + 1] where either may fall outside the row
+static inline uint32_t shear_edge(const uint32_t *line, int n, int k, int w)
+{
+    uint32_t p = (unsigned)k < (unsigned)n ? line[k] : SHEAR_BG;
+    uint32_t q = (unsigned)(k + 1) < (unsigned)n ? line[k + 1] : SHEAR_BG;
+    return lerp_bgra(p, q, w);
+}
+
+static inline uint32_t *row32(uint8_t *base, int stride, int row)
+{
+    return (uint32_t *)(base + (size_t)row * stride);
+}
+
+void shear_pass1_rows(const struct shear_frame *f, int row_begin, int row_end)
+{
+    const struct shear_plan *plan = f->plan;
+
+    //One converted source row per thread, sized on first use
+    thread_local std::vector<uint32_t> line;
+    if ((int)line.size() < f->width) {
+        line.resize(f->width);
+    }
+
+    for (int r = row_begin; r < row_end; r++) {
+        uint32_t *out = row32(f->tmp1, f->tmp_stride, r);
+        int sy = plan->flip ? f->height - 1 - r : r;
+
+        yuyv_convert(f->src + (size_t)sy * f->src_stride, f->width / 2, (uint8_t *)line.data());
+        if (plan->flip) {
+            for (int a = 0, b = f->width - 1; a < b; a++, b--) {
+                uint32_t p = line[a];
+                line[a] = line[b];
+                line[b] = p;
+            }
+        }
+
+        //Pixel c blends line[c + i] and line[c + i + 1], both inside for c in [lo, hi)
+        int i = plan->shift1[r] >> 8;
+        int w = plan->shift1[r] & 0xff;
+        int lo = -i > 0 ? -i : 0;
+        int hi = f->width - 1 - i < plan->width ? f->width - 1 - i : plan->width;
+        lo = lo < plan->width ? lo : plan->width;
+        hi = hi > lo ? hi : lo;
+
+        for (int c = 0; c < lo; c++) {
+            out[c] = shear_edge(line.data(), f->width, c + i, w);
+        }
+        lerp_row((const uint8_t *)(line.data() + lo + i), hi - lo, w, (uint8_t *)(out + lo));
+        for (int c = hi; c < plan->width; c++) {
+            out[c] = shear_edge(line.data(), f->width, c + i, w);
+        }
+    }
+}
+
+//Rows [row_begin, row_end) of columns [c0, c1) of the vertical pass, taps
+//outside tmp1 read as background
+static void shear_pass2_edge(const struct shear_frame *f, int c0, int c1, int row_begin, int row_end)
+{
+    const struct shear_plan *plan = f->plan;
+
+    for (int y = row_begin; y < row_end; y++) {
+        uint32_t *out = row32(f->tmp2, f->tmp_stride, y);
+        for (int c = c0; c < c1; c++) {
+            int r = y + (plan->shift2[c] >> 8);
+            uint32_t p = (unsigned)r < (unsigned)f->height ? row32(f->tmp1, f->tmp_stride, r)[c] : SHEAR_BG;
+            uint32_t q = (unsigned)(r + 1) < (unsigned)f->height ? row32(f->tmp1, f->tmp_stride, r + 1)[c] : SHEAR_BG;
+            out[c] = lerp_bgra(p, q, plan->shift2[c] & 0xff);
+        }
+    }
+}
+
+void shear_pass2_rows(const struct shear_frame *f, int row_begin, int row_end)
+{
+    const struct shear_plan *plan = f->plan;
+    int32_t offsets[SHEAR_STRIP];
+    uint8_t weights[SHEAR_STRIP];
+
+    //Strip mined so every row access touches one cache line of each of the
+    //few source rows a strip spans. Inside the rows where every tap of the
+    //strip is in tmp1, the strip is blended at once without bounds checks.
+    for (int c0 = 0, k = 0; c0 < plan->width; c0 += SHEAR_STRIP, k++) {
+        int c1 = c0 + SHEAR_STRIP < plan->width ? c0 + SHEAR_STRIP : plan->width;
+        int lo = plan->rows2[k * 2] > row_begin ? plan->rows2[k * 2] : row_begin;
+        int hi = plan->rows2[k * 2 + 1] < row_end ? plan->rows2[k * 2 + 1] : row_end;
+        lo = lo < row_end ? lo : row_end;
+        hi = hi > lo ? hi : lo;
+
+        for (int c = c0; c < c1; c++) {
+            offsets[c - c0] = (plan->shift2[c] >> 8) * f->tmp_stride + (c - c0) * 4;
+            weights[c - c0] = (uint8_t)(plan->shift2[c] & 0xff);
+        }
+        shear_pass2_edge(f, c0, c1, row_begin, lo);
+        lerp_columns(f->tmp1 + (size_t)lo * f->tmp_stride + (size_t)c0 * 4, f->tmp_stride, offsets, weights, c1 - c0,
+                     hi - lo, (uint8_t *)(row32(f->tmp2, f->tmp_stride, lo) + c0), f->tmp_stride);
+        shear_pass2_edge(f, c0, c1, hi, row_end);
+    }
+}
+
+void shear_pass3_rows(const struct shear_frame *f, int row_begin, int row_end)
+{
+    const struct shear_plan *plan = f->plan;
+
+    //The plan keeps every tap inside tmp2, no bounds checks needed
+    for (int y = row_begin; y < row_end; y++) {
+        const uint32_t *in = row32(f->tmp2, f->tmp_stride, y);
+        lerp_row((const uint8_t *)(in + (plan->shift3[y] >> 8)), f->width, plan->shift3[y] & 0xff,
+                 f->dst + (size_t)y * f->dst_stride);
+    }
+}
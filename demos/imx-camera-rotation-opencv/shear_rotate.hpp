@@ -0,0 +1,57 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+//Three shear (Paeth) rotation: R = X(t) * Y(s) * X(t), t = -tan(a/2), s = sin(a).
+//Every pass is a 1D shift with one sub-pixel weight per row (or per column),
+//so the source is always walked along contiguous rows instead of the
+//diagonal pattern of a direct bilinear warp.
+//  pass 1: YUYV source row -> BGRA, horizontal shift   (source -> tmp1)
+//  pass 2: vertical shift, cache line wide strips      (tmp1 -> tmp2)
+//  pass 3: horizontal shift into the output            (tmp2 -> output)
+//Angles beyond +-90 degrees are folded by reading the source rotated by 180.
+
+//Shift tables for one (width, height, angle)
+struct shear_plan {
+    bool flip;                      //Source read rotated by 180 degrees
+    int width;                      //Columns of the intermediate images
+    std::vector<int32_t> shift1;    //Q8 horizontal shift per tmp1 row
+    std::vector<int32_t> shift2;    //Q8 vertical shift per tmp2 column
+    std::vector<int32_t> rows2;     //Per strip of the vertical pass, first and last + 1
+                                    //tmp2 row whose taps are all inside tmp1
+    std::vector<int32_t> shift3;    //Q8 horizontal shift per output row
+};
+
+//Frame description for the shear passes, output has the size of the source
+struct shear_frame {
+    const uint8_t *src;             //YUYV
+    int width;
+    int height;
+    int src_stride;
+    uint8_t *tmp1;                  //BGRA, height rows of plan->width pixels
+    uint8_t *tmp2;
+    int tmp_stride;
+    uint8_t *dst;                   //BGRA
+    int dst_stride;
+    const struct shear_plan *plan;
+};
+
+//Same angle convention as rotate_map_init(). nearest: whole pixel shifts only,
+//the three integer shears then move every pixel without resampling it.
+void shear_plan_init(struct shear_plan *plan, int w, int h, int angle, bool nearest);
+
+//Intermediate image width needed for any angle (size tmp1/tmp2 with this)
+int shear_max_width(int w, int h);
+
+//Passes over rows [row_begin, row_end) of their destination, each pass must
+//be complete before the next one starts
+void shear_pass1_rows(const struct shear_frame *frame, int row_begin, int row_end);
+void shear_pass2_rows(const struct shear_frame *frame, int row_begin, int row_end);
+void shear_pass3_rows(const struct shear_frame *frame, int row_begin, int row_end);
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "rotate_kernels_impl.hpp"
+#include "yuv_rotate.hpp"
+
+using namespace cv;
+
+//Output rows per cv::remap call in remap_spans()
+#define REMAP_SPAN_ROWS 8
+
+void yuv_frame_create(struct yuv_frame *f, int w, int h)
+{
+    f->y_rot.create(h, w, CV_8UC1);
+    f->uv_rot.create((h + 1) / 2, w / 2, CV_8UC2);
+}
+
+void remap_spans(const Mat &src, const Mat &dst, const Mat &map1, const Mat &map2,
+                 const struct rotate_span *spans, int row_begin, int row_end, bool nearest, const Scalar &background)
+{
+    for (int y0 = row_begin; y0 < row_end; y0 += REMAP_SPAN_ROWS) {
+        int y1 = y0 + REMAP_SPAN_ROWS < row_end ? y0 + REMAP_SPAN_ROWS : row_end;
+        int begin = dst.cols, end = 0;
+        for (int y = y0; y < y1; y++) {
+            if (spans[y].begin < spans[y].end) {
+                begin = spans[y].begin < begin ? spans[y].begin : begin;
+                end = spans[y].end > end ? spans[y].end : end;
+            }
+        }
+        if (begin >= end) {
+            continue;
+        }
+
+        Rect roi(begin, y0, end - begin, y1 - y0);
+        Mat out = dst(roi);
+        if (nearest) {
+            remap(src, out, map1(roi), Mat(), INTER_NEAREST, BORDER_CONSTANT, background);
+        } else {
+            remap(src, out, map1(roi), map2(roi), INTER_LINEAR, BORDER_CONSTANT, background);
+        }
+    }
+}
+
+//Luma of source pixel (x, y), background if outside the frame
+static inline int yuv_luma(const struct yuv_frame *f, int x, int y)
+{
+    if ((unsigned)x < (unsigned)f->src.cols && (unsigned)y < (unsigned)f->src.rows) {
+        return f->src.data[(size_t)y * f->src.step + (size_t)x * 2];
+    }
+    return BG_Y;
+}
+
+//U/V of macropixel x (Y0, U, Y1, V) of source row y, background if outside the frame
+static inline void yuv_chroma(const struct yuv_frame *f, int x, int y, int *u, int *v)
+{
+    if ((unsigned)x < (unsigned)(f->src.cols / 2) && (unsigned)y < (unsigned)f->src.rows) {
+        const uint8_t *p = f->src.data + (size_t)y * f->src.step + (size_t)x * 4;
+        *u = p[1];
+        *v = p[3];
+    } else {
+        *u = BG_U;
+        *v = BG_V;
+    }
+}
+
+//Interpolations of the yuv engine: luma at luma position (sx, sy) and chroma
+//at chroma position (cx, cy), all in Q16
+struct yuv_nearest {
+    static inline int luma(const struct yuv_frame *f, int32_t sx, int32_t sy)
+    {
+        return yuv_luma(f, (sx + 0x8000) >> 16, (sy + 0x8000) >> 16);
+    }
+
+    static inline void chroma(const struct yuv_frame *f, int32_t cx, int32_t cy, int *u, int *v)
+    {
+        yuv_chroma(f, (cx + 0x8000) >> 16, (cy + 0x8000) >> 16, u, v);
+    }
+};
+
+template <class Blend>
+struct yuv_bilinear {
+    static inline int luma(const struct yuv_frame *f, int32_t sx, int32_t sy)
+    {
+        int x0 = sx >> 16;
+        int y0 = sy >> 16;
+
+        //All four taps inside the frame: read them without the bounds checks
+        if ((unsigned)x0 < (unsigned)(f->src.cols - 1) && (unsigned)y0 < (unsigned)(f->src.rows - 1)) {
+            const uint8_t *p = f->src.data + (size_t)y0 * f->src.step + (size_t)x0 * 2;
+            return Blend::blend(p[0], p[2], p[f->src.step], p[f->src.step + 2], sx, sy);
+        }
+        return Blend::blend(yuv_luma(f, x0, y0), yuv_luma(f, x0 + 1, y0), yuv_luma(f, x0, y0 + 1),
+                            yuv_luma(f, x0 + 1, y0 + 1), sx, sy);
+    }
+
+    static inline void chroma(const struct yuv_frame *f, int32_t cx, int32_t cy, int *u, int *v)
+    {
+        int pu[4], pv[4];
+        int x0 = cx >> 16;
+        int y0 = cy >> 16;
+
+        if ((unsigned)x0 < (unsigned)(f->src.cols / 2 - 1) && (unsigned)y0 < (unsigned)(f->src.rows - 1)) {
+            const uint8_t *p = f->src.data + (size_t)y0 * f->src.step + (size_t)x0 * 4;
+            *u = Blend::blend(p[1], p[5], p[f->src.step + 1], p[f->src.step + 5], cx, cy);
+            *v = Blend::blend(p[3], p[7], p[f->src.step + 3], p[f->src.step + 7], cx, cy);
+            return;
+        }
+        yuv_chroma(f, x0,     y0,     &pu[0], &pv[0]);
+        yuv_chroma(f, x0 + 1, y0,     &pu[1], &pv[1]);
+        yuv_chroma(f, x0,     y0 + 1, &pu[2], &pv[2]);
+        yuv_chroma(f, x0 + 1, y0 + 1, &pu[3], &pv[3]);
+        *u = Blend::blend(pu[0], pu[1], pu[2], pu[3], cx, cy);
+        *v = Blend::blend(pv[0], pv[1], pv[2], pv[3], cx, cy);
+    }
+};
+
+struct blend_q8 {
+    static inline int blend(int p00, int p01, int p10, int p11, int32_t sx, int32_t sy)
+    {
+        return fused_blend(p00, p01, p10, p11, (sx >> 8) & 0xff, (sy >> 8) & 0xff);
+    }
+};
+
+struct blend_q16_weights {
+    static inline int blend(int p00, int p01, int p10, int p11, int32_t sx, int32_t sy)
+    {
+        return blend_q16(p00, p01, p10, p11, sx & 0xffff, sy & 0xffff);
+    }
+};
+
+template <class Interp>
+static void yuv_rotate_interp(const struct yuv_frame *f, int row_begin, int row_end)
+{
+    const struct rotate_map *m = &f->plan->map;
+    const struct rotate_span *spans = f->plan->spans.data();
+    int height = f->y_rot.rows;
+
+    for (int y = row_begin; y < row_end; y++) {
+        uint8_t *out = (uint8_t *)f->y_rot.ptr(y);
+        int begin = spans[y].begin;
+        int32_t sx = m->xx * begin + m->xy * y + m->x0;
+        int32_t sy = m->yx * begin + m->yy * y + m->y0;
+        for (int x = begin; x < spans[y].end; x++) {
+            out[x] = (uint8_t)Interp::luma(f, sx, sy);
+            sx += m->xx;
+            sy += m->yx;
+        }
+    }
+
+    //Chroma row c covers output rows 2c and 2c + 1, it belongs to the band
+    //holding row 2c. Sample c, k is taken at the center of its 2x2 pixels;
+    //YUYV chroma is co-sited with the even luma pixel, so the chroma x is
+    //half the luma x.
+    for (int c = (row_begin + 1) / 2; c < (row_end + 1) / 2; c++) {
+        int begin = f->y_rot.cols, end = 0;
+        for (int y = c * 2; y < c * 2 + 2 && y < height; y++) {
+            if (spans[y].begin < spans[y].end) {
+                begin = spans[y].begin < begin ? spans[y].begin : begin;
+                end = spans[y].end > end ? spans[y].end : end;
+            }
+        }
+        if (begin >= end) {
+            continue;
+        }
+
+        uint8_t *out = (uint8_t *)f->uv_rot.ptr(c);
+        int k0 = begin / 2;
+        int k1 = (end + 1) / 2 < f->uv_rot.cols ? (end + 1) / 2 : f->uv_rot.cols;
+        int32_t sx = m->xx * k0 * 2 + m->xy * c * 2 + m->x0 + (m->xx + m->xy) / 2;
+        int32_t sy = m->yx * k0 * 2 + m->yy * c * 2 + m->y0 + (m->yx + m->yy) / 2;
+        for (int k = k0; k < k1; k++) {
+            int u, v;
+            Interp::chroma(f, sx >> 1, sy, &u, &v);
+            out[k * 2] = (uint8_t)u;
+            out[k * 2 + 1] = (uint8_t)v;
+            sx += m->xx * 2;
+            sy += m->yx * 2;
+        }
+    }
+}
+
+void yuv_rotate_rows(const struct yuv_frame *f, int row_begin, int row_end)
+{
+    switch (f->quality) {
+    case QUALITY_NEAREST:
+        yuv_rotate_interp<yuv_nearest>(f, row_begin, row_end);
+        break;
+    case QUALITY_Q16:
+        yuv_rotate_interp<yuv_bilinear<blend_q16_weights>>(f, row_begin, row_end);
+        break;
+    default:
+        yuv_rotate_interp<yuv_bilinear<blend_q8>>(f, row_begin, row_end);
+        break;
+    }
+}
+
+void yuv_convert_rows(const struct yuv_frame *f, int row_begin, int row_end)
+{
+    const struct rotate_span *spans = f->plan->spans.data();
+
+    for (int y = row_begin; y < row_end; y++) {
+        planar_convert_row(f->y_rot.ptr(y), f->uv_rot.ptr(y / 2), spans[y].begin, spans[y].end,
+                           (uint8_t *)f->dst.ptr(y));
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2026 NXP
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include "rotate_kernels.hpp"
+#include "rotation_plan.hpp"
+
+//Rotation in the YUV domain. The luma and chroma taps are read straight from
+//the YUYV source through the Q16 inverse map of the plan, so no map is read
+//and only a 1 byte luma plane and a quarter size chroma plane are written
+//instead of the 4 byte BGRA image. Only the pixels inside the rotated
+//footprint are converted.
+//  rotate:  YUYV -> Y plane + 4:2:0 UV plane (NV12 layout)   (output rows)
+//  convert: Y + UV -> BGRA inside the spans                  (output rows)
+//The rotate pass must be complete before the convert pass starts.
+struct yuv_frame {
+    cv::Mat src;        //YUYV, CV_8UC2
+    cv::Mat y_rot;      //Rotated luma, CV_8UC1 w x h
+    cv::Mat uv_rot;     //Rotated chroma, CV_8UC2 w/2 x (h+1)/2
+    cv::Mat dst;        //BGRA output
+    const struct rotation_plan *plan;
+    enum rotate_quality quality;    //QUALITY_NEAREST, QUALITY_Q8 or QUALITY_Q16
+};
+
+//Allocate the planes of a w x h frame
+void yuv_frame_create(struct yuv_frame *frame, int w, int h);
+
+//Luma of output rows [row_begin, row_end) inside the spans, and the chroma
+//rows starting in them
+void yuv_rotate_rows(const struct yuv_frame *frame, int row_begin, int row_end);
+//Writes the spans only, the background is left to rotate_fill_background()
+void yuv_convert_rows(const struct yuv_frame *frame, int row_begin, int row_end);
+
+//cv::remap of output rows [row_begin, row_end) restricted to the spans: one
+//call per REMAP_SPAN_ROWS rows over the union of their spans. Pixels outside
+//the spans are not written. Also used by the BGRA OpenCV engine.
+void remap_spans(const cv::Mat &src, const cv::Mat &dst, const cv::Mat &map1, const cv::Mat &map2,
+                 const struct rotate_span *spans, int row_begin, int row_end, bool nearest, const cv::Scalar &background);
@@ -19,13 +19,21 @@
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <linux/input-event-codes.h>
 #include <g2d.h>
 #include "xdg-shell-client-protocol.h"
 #include <mqueue.h>
 #include <sys/stat.h>
-#include <pthread.h>
+#include <getopt.h>
+#include "output_format.h"
+#include "v4l2_capture.h"
+#include "g2d_capture.h"
+#include "event_loop.h"
+#include "latency.h"
+#include "frame_pacer.h"
+#include "presentation-time-client-protocol.h"
 
 
 
@@ -52,6 +60,36 @@ GLuint texture, program;
 GLint position_attr, texcoord_attr, rotation_uniform,image_size_uniform, window_size_uniform ;
 float rotation_angle = 0.0f;
 
+//Texture sampling, set with --quality (nearest: GL_NEAREST, others: GL_LINEAR)
+static GLint texture_filter = GL_LINEAR;
+
+//Output format (--format). The compositor sees the EGL window buffers, so
+//the format selects the EGL config, RGB565 also uploads a 16 bpp texture.
+static enum output_format output_format = OUTPUT_FORMAT_AUTO;
+
+//V4L2 capture buffers and frame rate (--buffers, --capture-memory, --inflight, --latest, --fps)
+static unsigned int capture_buffers = CAPTURE_BUFFERS_DEFAULT;
+static enum capture_memory capture_memory = CAPTURE_MMAP;
+static unsigned int capture_inflight = CAPTURE_INFLIGHT_DEFAULT;
+static bool capture_latest = false;
+static double capture_fps = 0;
+static int capture_stats_interval = 0;
+
+//Camera buffers read in place by G2D (--source=import), or copied into
+//src_buf (--source=copy, or when G2D cannot address them)
+static bool source_import = true;
+static struct g2d_capture cam_g2d;
+
+//Presentation pacing (--pacing): render on wl_surface.frame callbacks or on
+//every camera frame
+static bool frame_pacing = true;
+static struct frame_pacer pacer;
+
+//Glass to glass latency report period and CSV log (--latency, --latency-log)
+static int latency_interval = 0;
+static const char *latency_log = NULL;
+static struct latency latency;
+
 //Global variables for Image data and angle capture
 unsigned char *image_data;
 int angle_deg;
@@ -66,6 +104,7 @@ struct xdg_toplevel *xdg_toplevel = NULL;
 struct wl_egl_window *egl_window = NULL;
 struct wl_pointer *pointer;
 struct wl_seat *seat;
+struct wp_presentation *presentation = NULL;
 bool moving;
 uint32_t pointer_serial;
 int32_t pointer_x, pointer_y;
@@ -172,6 +211,9 @@ static void registry_global(void *data, struct wl_registry *registry, uint32_t n
         if (seat) {
             wl_seat_add_listener(seat, &seat_listener, window);
         }
+    } else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+        presentation = wl_registry_bind(registry, name, &wp_presentation_interface, 1);
+        latency_set_presentation(&latency, presentation);
     }
 }
 
@@ -210,6 +252,20 @@ GLuint compile_shader(GLenum type, const char *source) {
    return shader;
 }
 
+//Bytes per pixel of the G2D output and of the texture uploaded from it
+static int texture_bpp(void) {
+    return output_format == OUTPUT_RGB565 ? 2 : 4;
+}
+
+//Upload image_data into the bound texture
+static void upload_texture(void) {
+    if (output_format == OUTPUT_RGB565) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, image_data);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+    }
+}
+
 //Initialization of OpenGL shaders and context
 int init_gl() {
     const char *vertex_shader_source =  "attribute vec2 position; \n"
@@ -263,9 +319,9 @@ int init_gl() {
     //Create texture
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    upload_texture();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture_filter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     return 1;
@@ -297,49 +353,166 @@ void GL_render() {
 }
 
 
-//Structure to pass data to the receiver thread (if needed)
-typedef struct {
-    mqd_t mq;
-} receiver_data_t;
- 
-//Receiver thread function
-void *receiver_thread(void *arg) {
-    receiver_data_t *data = (receiver_data_t *)arg;
-    mqd_t mq = data->mq;
-    char buffer[MAX_SIZE];
+//Event loop sources
+enum {
+    SOURCE_CAMERA = 0,
+    SOURCE_MESSAGES,
+    SOURCE_WATCHDOG,
+};
+//Period of the camera watchdog, reports when no frame arrived in between
+#define WATCHDOG_MS 1000
+
+//Read every pending angle message, returns 1 once the exit message arrived
+//and -1 if the queue failed
+static int read_angle_messages(mqd_t mq)
+{
+    char buffer[MAX_SIZE + 1];
     ssize_t bytes_read;
- 
-    printf("Receiver thread: Waiting for messages...\n");
- 
-    while (1) {
-        //Receive message from queue
-        bytes_read = mq_receive(mq, buffer, MAX_SIZE, NULL);
-        if (bytes_read == -1) {
-            perror("mq_receive");
-            break;
-        }
- 
+
+    while ((bytes_read = mq_receive(mq, buffer, MAX_SIZE, NULL)) >= 0) {
         buffer[bytes_read] = '\0'; // Null-terminate the string
-        angle_deg = atoi(buffer);
-        printf("Received angle: %i\n", angle_deg);
- 
+
         //Check if exit message is received
         if (strcmp(buffer, MSG_STOP) == 0) {
-            break;
+            return 1;
         }
+        angle_deg = atoi(buffer);
+        printf("Received angle: %i\n", angle_deg);
     }
-    printf("Receiver thread: Done\n");
-    pthread_exit(NULL);
+    if (errno != EAGAIN) {
+        perror("mq_receive");
+        return -1;
+    }
+    return 0;
 }
  
 
 
+static void print_usage(void)
+{
+    printf("Ussage: ./app, v4l2 device, width, height, angle [options]\n");
+    printf("Options:\n");
+    printf("  --quality=nearest|q8|q16|float  Texture filtering, nearest or linear (default: float)\n");
+    printf("  --format=auto|argb8888|xrgb8888|rgb565\n");
+    printf("                                  EGL window format (default: auto, xrgb8888)\n");
+    printf("  --buffers=N                     Camera buffers (default: %d)\n", CAPTURE_BUFFERS_DEFAULT);
+    printf("  --capture-memory=mmap|userptr|dmabuf\n");
+    printf("                                  Camera buffer memory (default: mmap)\n");
+    printf("  --inflight=N                    Camera buffers held while processing (default: %d)\n", CAPTURE_INFLIGHT_DEFAULT);
+    printf("  --capture-stats=N               Print captured, dropped and torn frames every N frames\n");
+    printf("  --latest                        Display only the newest camera frame, requeue the stale ones\n");
+    printf("  --fps=N                         Camera frame rate set with VIDIOC_S_PARM (default: the driver's)\n");
+    printf("  --pacing=frame|capture          Render on frame callbacks (default) or on every camera frame\n");
+    printf("  --latency=N                     Print capture to screen latency percentiles every N frames\n");
+    printf("  --latency-log=FILE              Write the latency of every frame to a CSV file\n");
+    printf("  --source=import|copy            G2D reads the camera buffers in place (default) or a copy\n");
+}
+
+//Parse the optional arguments following the positional ones
+static int parse_options(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"quality", required_argument, NULL, 'q'},
+        {"format", required_argument, NULL, 'f'},
+        {"buffers", required_argument, NULL, 'n'},
+        {"capture-memory", required_argument, NULL, 'm'},
+        {"inflight", required_argument, NULL, 'r'},
+        {"capture-stats", required_argument, NULL, 'c'},
+        {"latest", no_argument, NULL, 'l'},
+        {"fps", required_argument, NULL, 'v'},
+        {"pacing", required_argument, NULL, 'u'},
+        {"latency", required_argument, NULL, 'y'},
+        {"latency-log", required_argument, NULL, 'g'},
+        {"source", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    optind = 5;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'q':
+            //The GPU always filters in hardware, every bilinear mode maps to GL_LINEAR
+            if (strcmp(optarg, "nearest") == 0) {
+                texture_filter = GL_NEAREST;
+            } else if (strcmp(optarg, "q8") == 0 || strcmp(optarg, "q16") == 0 || strcmp(optarg, "float") == 0) {
+                texture_filter = GL_LINEAR;
+            } else {
+                fprintf(stderr, "Unknown quality: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'f':
+            if (output_format_parse(optarg, &output_format) < 0) {
+                fprintf(stderr, "Unknown output format: %s\n", optarg);
+                return -1;
+            }
+            //EGL renders RGB only, NV12 cannot back a window surface
+            if (output_format == OUTPUT_NV12) {
+                fprintf(stderr, "Output format nv12 is not supported by the OpenGL backend\n");
+                return -1;
+            }
+            break;
+        case 'n':
+            capture_buffers = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (capture_memory_parse(optarg, &capture_memory) < 0) {
+                fprintf(stderr, "Unknown capture memory: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'r':
+            capture_inflight = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            capture_stats_interval = atoi(optarg);
+            break;
+        case 'l':
+            capture_latest = true;
+            break;
+        case 'v':
+            capture_fps = strtod(optarg, NULL);
+            break;
+        case 'u':
+            if (strcmp(optarg, "frame") == 0) {
+                frame_pacing = true;
+            } else if (strcmp(optarg, "capture") == 0) {
+                frame_pacing = false;
+            } else {
+                fprintf(stderr, "Unknown pacing: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'y':
+            latency_interval = atoi(optarg);
+            break;
+        case 'g':
+            latency_log = optarg;
+            break;
+        case 's':
+            if (strcmp(optarg, "import") == 0) {
+                source_import = true;
+            } else if (strcmp(optarg, "copy") == 0) {
+                source_import = false;
+            } else {
+                fprintf(stderr, "Unknown source: %s\n", optarg);
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /************************ MAIN FUNCTION ******************************/
 int main(int argc, char *argv[]) 
 {
     //Verify arguments
-    if (argc != 5) {
-        printf("Ussage: ./app, v4l2 device, width, height, angle\n");
+    if (argc < 5) {
+        print_usage();
         return 1;
     }
     
@@ -348,12 +521,21 @@ int main(int argc, char *argv[])
     width = atoi(argv[2]);
     height = atoi(argv[3]);
     angle_deg = atoi(argv[4]);
+    if (parse_options(argc, argv) < 0) {
+        print_usage();
+        return 1;
+    }
+    if (latency_init(&latency, "opengl", latency_interval, latency_log) < 0) {
+        return 1;
+    }
+    if (output_format == OUTPUT_FORMAT_AUTO) {
+        output_format = OUTPUT_XRGB8888;
+    }
+    printf("Output format: %s\n", output_format_name(output_format));
 
-    //Adding threads initialization for messageQ
+    //Initialization for messageQ, read by the event loop
     mqd_t mq;
     struct mq_attr attr;
-    pthread_t receiver_tid;
-    receiver_data_t receiver_data;
  
     //Initialize queue attributes
     attr.mq_flags = 0;
@@ -362,99 +544,59 @@ int main(int argc, char *argv[])
     attr.mq_curmsgs = 0;
  
     //Open the message queue
-    mq = mq_open(QUEUE_NAME, O_RDONLY, 0644, &attr);
+    mq = mq_open(QUEUE_NAME, O_RDONLY | O_NONBLOCK, 0644, &attr);
     if (mq == (mqd_t)-1) {
         perror("mq_open");
         exit(1);
     }
- 
-    //Prepare data for receiver thread
-    receiver_data.mq = mq;
- 
-    //Create the receiver thread
-    if (pthread_create(&receiver_tid, NULL, receiver_thread, &receiver_data) != 0) {
-        perror("pthread_create");
-        mq_close(mq);
-        exit(1);
-    }
 
-    //Open USB camera
-    int cam_fd = open(camera_device, O_RDWR);
-    if (cam_fd < 0) {
-        perror("Failed to open camera");
-        return 1;
+    //Camera buffers G2D reads in place: with dmabuf memory they are G2D
+    //buffers the driver imports, with mmap the driver buffers are exported
+    //and imported into G2D
+    if (capture_buffers == 0) {
+        capture_buffers = CAPTURE_BUFFERS_DEFAULT;
     }
- 
-    //Configure camera format
-    struct v4l2_format fmt = {0};
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = width;
-    fmt.fmt.pix.height = height;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_ANY;
-    if (ioctl(cam_fd, VIDIOC_S_FMT, &fmt) < 0) {
-        perror("Failed to set format");
-        close(cam_fd);
+    if (source_import && capture_memory == CAPTURE_DMABUF &&
+        g2d_capture_alloc(&cam_g2d, capture_buffers, (size_t)width * height * 2) < 0) {
         return 1;
     }
- 
-    //Request V4L2 buffers
-    struct v4l2_requestbuffers req = {0};
-    req.count = 4;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    if (ioctl(cam_fd, VIDIOC_REQBUFS, &req) < 0) {
-        perror("Failed to request buffers");
-        close(cam_fd);
-        wl_display_disconnect(display);
+
+    //Open USB camera
+    struct capture_config cam_config = {
+        .device = camera_device,
+        .width = width,
+        .height = height,
+        .fourcc = V4L2_PIX_FMT_YUYV,
+        .buffers = capture_buffers,
+        .memory = capture_memory,
+        .inflight = capture_inflight,
+        .export_dmabuf = source_import && capture_memory == CAPTURE_MMAP,
+        .dmabuf_fds = cam_g2d.count ? cam_g2d.fds : NULL,
+        .nonblocking = true,
+        .latest = capture_latest,
+        .fps = capture_fps,
+    };
+    struct capture cam;
+    if (capture_open(&cam, &cam_config) < 0) {
+        g2d_capture_free(&cam_g2d);
         return 1;
     }
- 
-    //Map V4L2 buffers
-    void *cam_buffers[req.count];
-    struct v4l2_buffer buf;
-    size_t cam_buffer_lengths[req.count];
-    for (unsigned int i = 0; i < req.count; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        if (ioctl(cam_fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            perror("Failed to query buffer");
-            close(cam_fd);
-            wl_display_disconnect(display);
-            return 1;
-        }
-        cam_buffers[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, cam_fd, buf.m.offset);
-        cam_buffer_lengths[i] = buf.length;
-        if (cam_buffers[i] == MAP_FAILED) {
-            perror("Failed to mmap buffer");
-            close(cam_fd);
-            wl_display_disconnect(display);
-            return 1;
-        }
+    if (cam.format.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV) {
+        fprintf(stderr, "Camera does not support YUYV\n");
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
+        return 1;
     }
- 
-    //Queue V4L2 buffers
-    for (unsigned int i = 0; i < req.count; i++) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        if (ioctl(cam_fd, VIDIOC_QBUF, &buf) < 0) {
-            perror("Failed to queue buffer");
-            close(cam_fd);
-            wl_display_disconnect(display);
-            return 1;
-        }
+    if (source_import && !cam_g2d.count && g2d_capture_import(&cam_g2d, &cam) < 0) {
+        fprintf(stderr, "G2D cannot address the camera buffers, copying the frames\n");
     }
+    printf("Capture: %u %s buffers, %s\n", cam.count, capture_memory_name(cam.memory),
+           cam_g2d.count ? "read in place by G2D" : "copied for G2D");
  
     //Start streaming
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(cam_fd, VIDIOC_STREAMON, &type) < 0) {
-        perror("Failed to start streaming");
-        close(cam_fd);
-        wl_display_disconnect(display);
+    if (capture_start(&cam) < 0) {
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
         return 1;
     }
  
@@ -465,14 +607,16 @@ int main(int argc, char *argv[])
     int shm_fd = memfd_create("wayland-shm", 0);
     if (shm_fd < 0) {
         perror("memfd_create failed");
-        close(cam_fd);
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
         wl_display_disconnect(display);
         return 1;
     }
     if (ftruncate(shm_fd, size) < 0) {
         perror("ftruncate failed");
         close(shm_fd);
-        close(cam_fd);
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
         wl_display_disconnect(display);
         return 1;
     }
@@ -481,7 +625,8 @@ int main(int argc, char *argv[])
     if (shm_data == MAP_FAILED) {
         perror("mmap failed");
         close(shm_fd);
-        close(cam_fd);
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
         wl_display_disconnect(display);
         return 1;
     }
@@ -513,7 +658,7 @@ int main(int argc, char *argv[])
     wl_surface_commit(surface);
  
     //Initialize image buffer size
-    image_data = malloc(4* width * height);
+    image_data = malloc(texture_bpp() * width * height);
     
     //Initialize EGL
     egl_display = eglGetDisplay((EGLNativeDisplayType)display);
@@ -531,18 +676,22 @@ int main(int argc, char *argv[])
     eglBindAPI(EGL_OPENGL_ES_API);
  
     //Choose EGL configuration
+    bool rgb565 = output_format == OUTPUT_RGB565;
     EGLint config_attributes[] = {
         EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
         EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-        EGL_RED_SIZE, 8,
-        EGL_GREEN_SIZE, 8,
-        EGL_BLUE_SIZE, 8,
-        EGL_ALPHA_SIZE, 8,
+        EGL_RED_SIZE, rgb565 ? 5 : 8,
+        EGL_GREEN_SIZE, rgb565 ? 6 : 8,
+        EGL_BLUE_SIZE, rgb565 ? 5 : 8,
+        EGL_ALPHA_SIZE, output_format == OUTPUT_ARGB8888 ? 8 : 0,
         EGL_NONE
     };
     EGLConfig config;
     EGLint num_config;
-    eglChooseConfig(egl_display, config_attributes, &config, 1, &num_config);
+    if (!eglChooseConfig(egl_display, config_attributes, &config, 1, &num_config) || num_config < 1) {
+        fprintf(stderr, "No EGL config for output format %s\n", output_format_name(output_format));
+        return 1;
+    }
  
     //Create EGL context
     EGLint context_attributes[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
@@ -572,6 +721,10 @@ int main(int argc, char *argv[])
         return 1;
     }
     glViewport(0, 0, width, height);
+    //Paced by our own frame callbacks, a blocking swap would stall the event loop
+    if (frame_pacing) {
+        eglSwapInterval(egl_display, 0);
+    }
 
     //Initialize G2D
     if (g2d_open(&g2d_handle) != 0) {
@@ -579,19 +732,25 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    //Allocate source and destination buffers
-    src_buf = g2d_alloc(width * height * 2, 0);  //src_buf is YUV 16 bpp
-    dst_buf = g2d_alloc(width * height * 4, 0);  //dst_buf is RGBA 32 bpp
+    //Allocate source and destination buffers, src_buf is only needed to copy camera frames to
+    if (!cam_g2d.count) {
+        src_buf = g2d_alloc(width * height * 2, 0);  //src_buf is YUV 16 bpp
+    }
+    dst_buf = g2d_alloc(width * height * texture_bpp(), 0);  //dst_buf is RGBA 32 bpp or RGB565 16 bpp
 
-    if (!src_buf || !dst_buf) {
+    if ((!cam_g2d.count && !src_buf) || !dst_buf) {
         fprintf(stderr, "Failed to allocate G2D buffers\n");
         g2d_close(g2d_handle);
         return -1;
     }
 
-    //Configure source surface
-    src.format = G2D_YVYU;
-    src.planes[0] = src_buf->buf_paddr;
+    //Configure source surface, its plane follows the camera buffer of each frame when read in place.
+    //YVYU swaps U and V to cancel the R/B swap of the BGRA8888 blit uploaded as GL_RGBA, RGB565
+    //matches GL_UNSIGNED_SHORT_5_6_5 and is converted from the true YUYV order.
+    src.format = output_format == OUTPUT_RGB565 ? G2D_YUYV : G2D_YVYU;
+    if (src_buf) {
+        src.planes[0] = src_buf->buf_paddr;
+    }
     src.left = 0;
     src.top = 0;
     src.right = width;
@@ -601,7 +760,7 @@ int main(int argc, char *argv[])
     src.height = height;
     src.rot = G2D_ROTATION_0;    
     //Configure destination surface (use SHM buffer for output)
-    dst.format = G2D_BGRA8888;
+    dst.format = output_format == OUTPUT_RGB565 ? G2D_RGB565 : G2D_BGRA8888;
     dst.planes[0] = dst_buf->buf_paddr;  
     dst.left = 0;
     dst.top = 0;
@@ -611,49 +770,103 @@ int main(int argc, char *argv[])
     dst.width = width;
     dst.height = height;
 
+    //Event loop: camera frames, angle messages, camera watchdog and Wayland events
+    struct event_loop loop;
+    if (event_loop_init(&loop, display) < 0 || event_loop_add(&loop, cam.fd, SOURCE_CAMERA) < 0 ||
+        event_loop_add(&loop, mq, SOURCE_MESSAGES) < 0 || event_loop_add_timer(&loop, WATCHDOG_MS, SOURCE_WATCHDOG) < 0) {
+        event_loop_close(&loop);
+        capture_close(&cam);
+        g2d_capture_free(&cam_g2d);
+        wl_display_disconnect(display);
+        return 1;
+    }
+
     printf("\nInitializations completed (including OpenGL and messageQ),\nentering to the loop...\n");
     
-    //Main loop
-    while (1) {
-
-        //Dequeue a frame
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        if (ioctl(cam_fd, VIDIOC_DQBUF, &buf) < 0) {
-            perror("Failed to dequeue buffer");
+    //Main loop: the newest camera frame is processed as soon as the
+    //compositor asks for a frame (on arrival with --pacing=capture)
+    frame_pacer_init(&pacer, frame_pacing);
+    unsigned long watchdog_frames = 0;
+    struct v4l2_buffer buf;
+    bool pending = false;
+    uint32_t ready;
+    while (event_loop_wait(&loop, &ready) == 0) {
+
+        //Angle messages, the exit message ends the loop
+        if ((ready & EVENT_SOURCE(SOURCE_MESSAGES)) && read_angle_messages(mq) != 0) {
             break;
         }
-  
-        //Requeue the buffer
-        if (ioctl(cam_fd, VIDIOC_QBUF, &buf) < 0) {
-            perror("Failed to queue buffer");
-            break;
+
+        //Camera watchdog
+        if (ready & EVENT_SOURCE(SOURCE_WATCHDOG)) {
+            if (cam.stats.frames + cam.stats.torn == watchdog_frames) {
+                fprintf(stderr, "No frame from the camera for %d ms\n", WATCHDOG_MS);
+            }
+            watchdog_frames = cam.stats.frames + cam.stats.torn;
         }
 
-        //Copy image data to source buffer
-        memcpy(src_buf->buf_vaddr, cam_buffers[buf.index], width * height * 2);
+        //Dequeue the newest frame. Until the compositor asks for a frame it
+        //waits as the pending frame, a newer one replaces it and it goes back
+        //to the driver unseen.
+        if (ready & EVENT_SOURCE(SOURCE_CAMERA)) {
+            if (pending) {
+                pending = false;
+                cam.stats.skipped++;
+                if (capture_queue(&cam, buf.index) < 0) {
+                    break;
+                }
+            }
+            if (capture_dequeue(&cam, &buf) == 0) {
+                pending = true;
+                if (capture_stats_interval > 0 && cam.stats.frames % capture_stats_interval == 0) {
+                    capture_print_stats(&cam);
+                }
+            } else if (errno != EAGAIN) {
+                break;
+            }
+        }
+        if (!pending || !frame_pacer_ready(&pacer)) {
+            continue;
+        }
+        pending = false;
+        frame_pacer_begin(&pacer);
+        struct latency_frame *frame_latency = latency_begin(&latency, &buf);
+
+        //Blit source: the camera buffer itself, or a copy of it in src_buf.
+        //The oldest buffers go back to the driver once G2D no longer reads them.
+        if (cam_g2d.count) {
+            src.planes[0] = g2d_capture_paddr(&cam_g2d, buf.index);
+        } else {
+            memcpy(src_buf->buf_vaddr, cam.buffers[buf.index].data, width * height * 2);
+            if (capture_trim(&cam) < 0) {
+                break;
+            }
+        }
+        latency_stamp(frame_latency, LATENCY_CONVERT);
 
         //Perform G2D blit (rotate into SHM buffer)
         g2d_blit(g2d_handle, &src, &dst);
         g2d_finish(g2d_handle);        
+        if (cam_g2d.count && capture_trim(&cam) < 0) {
+            break;
+        }
 
         //Copy image data from destination buffer and regenerate texture        
-        memcpy(image_data, dst_buf->buf_vaddr, width * height * 4); 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);     
+        memcpy(image_data, dst_buf->buf_vaddr, width * height * texture_bpp()); 
+        upload_texture();
 
         //Update angle and render
         rotation_angle = M_PI*angle_deg/180;
-        wl_display_dispatch_pending(display);
         GL_render();
+        latency_stamp(frame_latency, LATENCY_ROTATE);
  
-        //Swap buffers
+        //Swap buffers, this commits the surface
+        latency_commit(frame_latency, surface);
+        frame_pacer_commit(&pacer, surface);
         eglSwapBuffers(egl_display, egl_surface);
     }
     
-    //Wait for the receiver thread to finish
-    if (pthread_join(receiver_tid, NULL) != 0) {
-        perror("pthread_join");
-    }
+    event_loop_close(&loop);
  
     //Close the queue
     if (mq_close(mq) == -1) {
@@ -662,11 +875,13 @@ int main(int argc, char *argv[])
     }
 
     //Cleanup
-    ioctl(cam_fd, VIDIOC_STREAMOFF, &type);
-    for (unsigned int i = 0; i < req.count; i++) {
-        munmap(cam_buffers[i], cam_buffer_lengths[i]);
+    latency_close(&latency);
+    if (presentation) {
+        wp_presentation_destroy(presentation);
     }
-    close(cam_fd);
+    capture_close(&cam);
+    g2d_capture_free(&cam_g2d);
+    frame_pacer_destroy(&pacer);
     munmap(shm_data, size);
     eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglDestroySurface(egl_display, egl_surface);
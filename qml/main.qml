@@ -112,11 +112,36 @@ ApplicationWindow {
         }
     }
 
+    Label{
+        id: label_qualityselector
+        text: qsTr("Quality:")
+        anchors.top: parent.top
+        anchors.left: combobox_resolutionselector.right
+        anchors.leftMargin: 20
+        anchors.topMargin: 15
+    }
+
+    ComboBox{
+        id: combobox_qualityselector
+        width:120
+        anchors.left: label_qualityselector.right
+        anchors.top: parent.top
+        anchors.margins:10
+        currentIndex: 0
+
+        // Fastest last: nearest neighbour trades quality for frame rate
+        model: ["float", "q16", "q8", "nearest"]
+        onActivated: function(index) {
+                console.log("Selected Quality:", model[index])
+                mediastream.quality = model[index];
+        }
+    }
+
     Label{
         id: label_showangle
         text: qsTr("Current Angle:")
         anchors.top: parent.top
-        anchors.left: combobox_resolutionselector.right
+        anchors.left: combobox_qualityselector.right
         anchors.leftMargin: 20
         anchors.topMargin: 15
     }